@@ -28,6 +28,8 @@ extern "C" {
 
 ason_t *ason_ns_read(ason_ns_t *ns, const char *text, ...);
 ason_t *ason_ns_readn(ason_ns_t *ns, const char *text, size_t length, ...);
+ason_t *ason_ns_read_file(ason_ns_t *ns, const char *path, ...);
+ason_tpl_t *ason_ns_prepare(ason_ns_t *ns, const char *text);
 
 #ifdef __cplusplus
 }
@@ -20,14 +20,43 @@
 #ifndef ASON_OUTPUT_H
 #define ASON_OUTPUT_H
 
+#include <stdio.h>
+#include <stddef.h>
+#include <sys/types.h>
+
 #include <ason/ason.h>
 
+/**
+ * A growable output buffer. `data` holds `length` bytes followed by a NUL, in
+ * an allocation of `size` bytes made with malloc().
+ **/
+typedef struct ason_buffer {
+	char *data;
+	size_t length;
+	size_t size;
+} ason_buffer_t;
+
+#define ASON_BUFFER_INIT { NULL, 0, 0 }
+
+/* Print flags */
+#define ASON_PRINT_UNICODE 0x1
+
+/* JSON print flags */
+#define ASON_JSON_COMPACT	0x0
+#define ASON_JSON_PRETTY	0x1
+#define ASON_JSON_CANONICAL	0x2
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 char *ason_asprint(ason_t *value);
 char *ason_asprint_unicode(ason_t *value);
+size_t ason_snprint(char *str, size_t len, ason_t *value, int flags);
+size_t ason_print_to_buffer(ason_buffer_t *buf, ason_t *value, int flags);
+ssize_t ason_fprint(FILE *file, ason_t *value);
+ssize_t ason_write(int fd, ason_t *value);
+char *ason_print_json(ason_t *value, int flags);
 
 #ifdef __cplusplus
 }
@@ -22,12 +22,27 @@
 
 #include <ason/ason.h>
 
+/**
+ * A compiled ASON template.
+ **/
+typedef struct ason_tpl ason_tpl_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 ason_t *ason_read(const char *text, ...);
 ason_t *ason_readn(const char *text, size_t length, ...);
+ason_t *ason_read_file(const char *path, ...);
+ason_t *ason_read_json(const char *text);
+ason_t *ason_readn_json(const char *text, size_t length);
+ason_t *ason_read_lazy(const char *text);
+ason_t *ason_readn_lazy(const char *text, size_t length);
+ason_t *ason_readn_parallel(const char *text, size_t length,
+			    unsigned int threads);
+ason_tpl_t *ason_prepare(const char *text);
+ason_t *ason_bind_exec(ason_tpl_t *tpl, ...);
+void ason_tpl_destroy(ason_tpl_t *tpl);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,121 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "buffer.h"
+#include "util.h"
+
+/**
+ * Smallest allocation we give a buffer.
+ **/
+#define BUFFER_MIN_SIZE 64
+
+/**
+ * Enlarge a buffer so it can hold `length` more bytes plus a terminating NUL.
+ * The size at least doubles each time so appending is amortised linear.
+ **/
+void
+buffer_grow(ason_buffer_t *buf, size_t length)
+{
+	size_t size = buf->size ? buf->size : BUFFER_MIN_SIZE;
+
+	while (size - buf->length <= length)
+		size *= 2;
+
+	buf->data = xrealloc(buf->data, size);
+	buf->size = size;
+}
+
+/**
+ * Pass text to a buffer's flush function, unless an earlier flush failed.
+ **/
+static void
+buffer_write(struct buffer *buf, struct iovec *iov, int count)
+{
+	size_t total = 0;
+	int i;
+
+	if (buf->failed)
+		return;
+
+	for (i = 0; i < count; i++)
+		total += iov[i].iov_len;
+
+	if (buf->flush(buf, iov, count) < 0)
+		buf->failed = 1;
+	else
+		buf->written += total;
+}
+
+/**
+ * Pass everything held in a fixed size buffer to its flush function.
+ **/
+void
+buffer_flush(struct buffer *buf)
+{
+	ason_buffer_t *out = buf->out;
+	struct iovec iov = { out->data, out->length };
+
+	if (! out->length)
+		return;
+
+	buffer_write(buf, &iov, 1);
+	out->length = 0;
+	out->data[0] = '\0';
+}
+
+/**
+ * Append text which does not fit in the space left in a buffer. Growable
+ * buffers are enlarged. Truncating buffers take what they can. Flushed
+ * buffers are emptied, and text too large to hold at all is written along
+ * with them instead of being copied.
+ **/
+void
+buffer_append_slow(struct buffer *buf, const char *data, size_t length)
+{
+	ason_buffer_t *out = buf->out;
+	struct iovec iov[2];
+	size_t room;
+
+	if (buf->truncate) {
+		room = out->size ? out->size - out->length - 1 : 0;
+		buf->written += length - room;
+		length = room;
+
+		if (! out->size)
+			return;
+	} else if (! buf->flush) {
+		buffer_grow(out, length);
+	} else if (length < out->size) {
+		buffer_flush(buf);
+	} else {
+		iov[0].iov_base = out->data;
+		iov[0].iov_len = out->length;
+		iov[1].iov_base = (char *)data;
+		iov[1].iov_len = length;
+
+		buffer_write(buf, iov, 2);
+		out->length = 0;
+		out->data[0] = '\0';
+		return;
+	}
+
+	memcpy(out->data + out->length, data, length);
+	out->length += length;
+	out->data[out->length] = '\0';
+}
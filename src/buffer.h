@@ -0,0 +1,88 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <ason/print.h>
+
+/**
+ * Output being printed into. Text collects in `out`. If `flush` is set, `out`
+ * has a fixed size, and is emptied by passing its contents to `flush` whenever
+ * it fills. If `truncate` is set, `out` has a fixed size and text which does
+ * not fit is dropped. Otherwise `out` grows as needed. `written` counts the
+ * bytes flushed or dropped so far, and `failed` is set once a flush has
+ * failed, after which output is discarded.
+ **/
+struct buffer {
+	ason_buffer_t *out;
+	int (*flush)(struct buffer *buf, struct iovec *iov, int count);
+	int truncate;
+	int fd;
+	FILE *file;
+	size_t written;
+	int failed;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void buffer_grow(ason_buffer_t *buf, size_t length);
+void buffer_append_slow(struct buffer *buf, const char *data, size_t length);
+void buffer_flush(struct buffer *buf);
+
+/**
+ * Append `length` bytes to a buffer.
+ **/
+static inline void
+buffer_append(struct buffer *buf, const char *data, size_t length)
+{
+	ason_buffer_t *out = buf->out;
+
+	if (out->size - out->length <= length) {
+		buffer_append_slow(buf, data, length);
+		return;
+	}
+
+	memcpy(out->data + out->length, data, length);
+	out->length += length;
+	out->data[out->length] = '\0';
+}
+
+/**
+ * Append a NUL-terminated string to a buffer.
+ **/
+static inline void
+buffer_puts(struct buffer *buf, const char *str)
+{
+	buffer_append(buf, str, strlen(str));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BUFFER_H */
@@ -19,18 +19,28 @@
 
 #include <string.h>
 #include <endian.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CRC_PCLMUL
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
 
 #include "crc.h"
+#include "util.h"
 
 /* CRC-64-ECMA polynomial, see ECMA-182 */
-#define POLY 0x42F0E1EBA9EA3693 
+#define POLY 0x42F0E1EBA9EA3693ULL
 
 /**
  * Calculate the crc-64 checksum for 64 bits of data which have been packed
- * into a 64-bit unsigned integer in host byte-order.
+ * into a 64-bit unsigned integer in host byte-order. This works one bit at a
+ * time, and is kept as a reference for the table-driven version.
  **/
 uint64_t
-crc64_8h(uint64_t data)
+crc64_8h_bitwise(uint64_t data)
 {
 	uint64_t remainder_xor = POLY << 63;
 	uint64_t test_bit = (uint64_t)1 << 63;
@@ -52,11 +62,11 @@ crc64_8h(uint64_t data)
 }
 
 /**
- * Calculate the CRC-64 checksum for a stream of data. Return as a host
- * byte-order integer.
+ * Calculate the CRC-64 checksum for a stream of data one bit at a time. This
+ * is the reference for crc64().
  **/
 uint64_t
-crc64(unsigned char *data, size_t size)
+crc64_bitwise(unsigned char *data, size_t size)
 {
 	uint64_t in;
 	uint64_t out = 0;
@@ -65,7 +75,7 @@ crc64(unsigned char *data, size_t size)
 		memcpy(&in, data, 8);
 		in = be64toh(in);
 
-		out = crc64_8h(in ^ out);
+		out = crc64_8h_bitwise(in ^ out);
 		size -= 8;
 		data += 8;
 	}
@@ -81,7 +91,384 @@ crc64(unsigned char *data, size_t size)
 
 	in >>= 64 - (size * 8);
 	out <<= size * 8;
-	out ^= crc64_8h(in);
+	out ^= crc64_8h_bitwise(in);
 
 	return out;
 }
+
+/**
+ * Multiply two polynomials modulo the CRC polynomial.
+ **/
+static uint64_t
+crc_multmod(uint64_t a, uint64_t b)
+{
+	uint64_t ret = 0;
+	int i;
+
+	for (i = 63; i >= 0; i--) {
+		ret = (ret << 1) ^ (ret >> 63 ? POLY : 0);
+
+		if ((a >> i) & 1)
+			ret ^= b;
+	}
+
+	return ret;
+}
+
+/**
+ * Tables for slicing-by-8. crc_table[k][b] is the checksum of the byte b
+ * followed by k zero bytes, so the checksum of a 64-bit word is the XOR of one
+ * lookup per byte.
+ **/
+static uint64_t crc_table[8][256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+/**
+ * crc_x2n_table[k] is x^(2^k) modulo the polynomial. Moving a checksum past n
+ * bytes multiplies it by x^(8n), which is a product of these.
+ **/
+static uint64_t crc_x2n_table[67];
+
+/**
+ * Each thread of crc64_parallel() checksums at least this many bytes.
+ **/
+#define CRC_PARALLEL_MIN_LENGTH (1 << 20)
+
+/**
+ * The fastest implementation of crc64_update() this CPU supports.
+ **/
+static uint64_t (*crc_update_impl)(uint64_t crc, const unsigned char *data,
+				   size_t size) = crc64_update_table;
+
+#ifdef CRC_PCLMUL
+/**
+ * Powers of x modulo the polynomial, for folding 128-bit blocks forward by
+ * 128, 256, 384 and 512 bits. The high half of each multiplies the high 64
+ * bits of a block, and the low half the low 64 bits.
+ **/
+static __m128i crc_fold_128;
+static __m128i crc_fold_256;
+static __m128i crc_fold_384;
+static __m128i crc_fold_512;
+
+static uint64_t crc64_update_pclmul(uint64_t crc, const unsigned char *data,
+				    size_t size);
+
+/**
+ * Calculate x^n modulo the polynomial.
+ **/
+static uint64_t
+crc_xpow(int n)
+{
+	uint64_t ret = 1;
+
+	while (n--)
+		ret = (ret << 1) ^ (ret >> 63 ? POLY : 0);
+
+	return ret;
+}
+
+/**
+ * Build a pair of folding constants for moving a block forward `n` bits.
+ **/
+static __m128i
+crc_fold_constant(int n)
+{
+	return _mm_set_epi64x(crc_xpow(n + 64), crc_xpow(n));
+}
+
+/**
+ * Check for the instructions crc64_update_pclmul() needs, and set up its
+ * constants if they're there.
+ **/
+static void
+crc_pclmul_init(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (! __get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+	    ! (ecx & bit_PCLMUL) || ! (ecx & bit_SSSE3))
+		return;
+
+	crc_fold_128 = crc_fold_constant(128);
+	crc_fold_256 = crc_fold_constant(256);
+	crc_fold_384 = crc_fold_constant(384);
+	crc_fold_512 = crc_fold_constant(512);
+	crc_update_impl = crc64_update_pclmul;
+}
+#endif /* CRC_PCLMUL */
+
+/**
+ * Fill in the slicing-by-8 tables from the bitwise implementation, and pick
+ * an implementation for crc64_update().
+ **/
+static void
+crc_table_init(void)
+{
+	int k;
+	int b;
+
+	for (k = 0; k < 8; k++)
+		for (b = 0; b < 256; b++)
+			crc_table[k][b] = crc64_8h_bitwise((uint64_t)b << (8 * k));
+
+	crc_x2n_table[0] = 2;
+
+	for (k = 1; k < 67; k++)
+		crc_x2n_table[k] = crc_multmod(crc_x2n_table[k - 1],
+					       crc_x2n_table[k - 1]);
+
+#ifdef CRC_PCLMUL
+	crc_pclmul_init();
+#endif
+}
+
+/**
+ * Checksum a 64-bit word once the tables are ready.
+ **/
+static inline uint64_t
+crc64_slice8(uint64_t data)
+{
+	return crc_table[7][data >> 56] ^
+		crc_table[6][(data >> 48) & 0xff] ^
+		crc_table[5][(data >> 40) & 0xff] ^
+		crc_table[4][(data >> 32) & 0xff] ^
+		crc_table[3][(data >> 24) & 0xff] ^
+		crc_table[2][(data >> 16) & 0xff] ^
+		crc_table[1][(data >> 8) & 0xff] ^
+		crc_table[0][data & 0xff];
+}
+
+/**
+ * Calculate the crc-64 checksum for 64 bits of data which have been packed
+ * into a 64-bit unsigned integer in host byte-order.
+ **/
+uint64_t
+crc64_8h(uint64_t data)
+{
+	pthread_once(&crc_table_once, crc_table_init);
+	return crc64_slice8(data);
+}
+
+/**
+ * Continue a CRC-64 checksum over more data using the slicing-by-8 tables.
+ **/
+uint64_t
+crc64_update_table(uint64_t crc, const unsigned char *data, size_t size)
+{
+	uint64_t in;
+
+	pthread_once(&crc_table_once, crc_table_init);
+
+	while (size >= 8) {
+		memcpy(&in, data, 8);
+		crc = crc64_slice8(be64toh(in) ^ crc);
+		size -= 8;
+		data += 8;
+	}
+
+	while (size--)
+		crc = (crc << 8) ^ crc_table[0][(crc >> 56) ^ *data++];
+
+	return crc;
+}
+
+#ifdef CRC_PCLMUL
+/**
+ * Load 16 bytes as a 128-bit polynomial, with the first byte holding the
+ * highest powers.
+ **/
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i
+crc_load(const unsigned char *data)
+{
+	const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+					     8, 9, 10, 11, 12, 13, 14, 15);
+
+	return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data),
+				reverse);
+}
+
+/**
+ * Multiply a 128-bit block by a pair of folding constants, giving a value
+ * which is congruent to the block moved forward by the constants' distance.
+ **/
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i
+crc_fold(__m128i block, __m128i constant)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(block, constant, 0x11),
+			     _mm_clmulepi64_si128(block, constant, 0x00));
+}
+
+/**
+ * Continue a CRC-64 checksum over more data by folding it down 64 bytes at a
+ * time with carry-less multiplies. What remains is finished with the tables.
+ **/
+__attribute__((target("pclmul,ssse3")))
+static uint64_t
+crc64_update_pclmul(uint64_t crc, const unsigned char *data, size_t size)
+{
+	__m128i x0, x1, x2, x3;
+	uint64_t hi;
+	uint64_t lo;
+
+	if (size < 128)
+		return crc64_update_table(crc, data, size);
+
+	x0 = _mm_xor_si128(crc_load(data), _mm_set_epi64x(crc, 0));
+	x1 = crc_load(data + 16);
+	x2 = crc_load(data + 32);
+	x3 = crc_load(data + 48);
+	data += 64;
+	size -= 64;
+
+	while (size >= 64) {
+		x0 = _mm_xor_si128(crc_fold(x0, crc_fold_512), crc_load(data));
+		x1 = _mm_xor_si128(crc_fold(x1, crc_fold_512),
+				   crc_load(data + 16));
+		x2 = _mm_xor_si128(crc_fold(x2, crc_fold_512),
+				   crc_load(data + 32));
+		x3 = _mm_xor_si128(crc_fold(x3, crc_fold_512),
+				   crc_load(data + 48));
+		data += 64;
+		size -= 64;
+	}
+
+	x0 = _mm_xor_si128(crc_fold(x0, crc_fold_384),
+			   _mm_xor_si128(crc_fold(x1, crc_fold_256),
+					 _mm_xor_si128(crc_fold(x2, crc_fold_128),
+						       x3)));
+
+	while (size >= 16) {
+		x0 = _mm_xor_si128(crc_fold(x0, crc_fold_128), crc_load(data));
+		data += 16;
+		size -= 16;
+	}
+
+	/* The folded block is now 16 bytes of message with the same checksum
+	 * as everything so far. */
+	hi = _mm_cvtsi128_si64(_mm_unpackhi_epi64(x0, x0));
+	lo = _mm_cvtsi128_si64(x0);
+	crc = crc64_slice8(hi);
+	crc = crc64_slice8(lo ^ crc);
+
+	return crc64_update_table(crc, data, size);
+}
+#endif /* CRC_PCLMUL */
+
+/**
+ * Continue a CRC-64 checksum over more data. `crc` is the value returned by
+ * crc64_init() or by an earlier call to this function.
+ **/
+uint64_t
+crc64_update(uint64_t crc, const unsigned char *data, size_t size)
+{
+	pthread_once(&crc_table_once, crc_table_init);
+	return crc_update_impl(crc, data, size);
+}
+
+/**
+ * Calculate the CRC-64 checksum for a stream of data. Return as a host
+ * byte-order integer.
+ **/
+uint64_t
+crc64(unsigned char *data, size_t size)
+{
+	return crc64_final(crc64_update(crc64_init(), data, size));
+}
+
+/**
+ * Combine the checksums of two runs of data into the checksum of the first
+ * run followed by the second, where the second run is `len_b` bytes long.
+ * The checksum is linear and starts from 0, so this is `crc_a` moved forward
+ * by `len_b` bytes, XORed with `crc_b`. Takes O(log len_b) time.
+ **/
+uint64_t
+crc64_combine(uint64_t crc_a, uint64_t crc_b, size_t len_b)
+{
+	int k;
+
+	pthread_once(&crc_table_once, crc_table_init);
+
+	for (k = 3; len_b; k++, len_b >>= 1)
+		if (len_b & 1)
+			crc_a = crc_multmod(crc_x2n_table[k], crc_a);
+
+	return crc_a ^ crc_b;
+}
+
+/**
+ * A run of data for one thread of crc64_parallel() to checksum.
+ **/
+struct crc_job {
+	const unsigned char *data;
+	size_t size;
+	uint64_t crc;
+	int threaded;
+	pthread_t thread;
+};
+
+/**
+ * Checksum one run of data.
+ **/
+static void *
+crc_parallel_run(void *data)
+{
+	struct crc_job *job = data;
+
+	job->crc = crc64_update(crc64_init(), job->data, job->size);
+	return NULL;
+}
+
+/**
+ * Calculate the CRC-64 checksum of a buffer by checksumming pieces of it on
+ * up to `threads` threads and combining the results. If `threads` is 0, use
+ * one thread per online CPU. Small buffers are checksummed on the calling
+ * thread.
+ **/
+uint64_t
+crc64_parallel(const unsigned char *data, size_t size, unsigned int threads)
+{
+	struct crc_job *jobs;
+	size_t share;
+	uint64_t crc;
+	unsigned int i;
+
+	if (! threads)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (threads > size / CRC_PARALLEL_MIN_LENGTH)
+		threads = size / CRC_PARALLEL_MIN_LENGTH;
+
+	if (threads < 2)
+		return crc64_final(crc64_update(crc64_init(), data, size));
+
+	jobs = xcalloc(threads, sizeof(struct crc_job));
+	share = (size / threads) & ~(size_t)63;
+
+	for (i = 0; i < threads; i++) {
+		jobs[i].data = data + i * share;
+		jobs[i].size = i == threads - 1 ? size - i * share : share;
+	}
+
+	for (i = 1; i < threads; i++)
+		jobs[i].threaded = ! pthread_create(&jobs[i].thread, NULL,
+						    crc_parallel_run, &jobs[i]);
+
+	for (i = 0; i < threads; i++)
+		if (! jobs[i].threaded)
+			crc_parallel_run(&jobs[i]);
+
+	crc = jobs[0].crc;
+
+	for (i = 1; i < threads; i++) {
+		if (jobs[i].threaded)
+			pthread_join(jobs[i].thread, NULL);
+
+		crc = crc64_combine(crc, jobs[i].crc, jobs[i].size);
+	}
+
+	free(jobs);
+	return crc64_final(crc);
+}
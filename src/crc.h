@@ -20,14 +20,43 @@
 #ifndef CRC_H
 #define CRC_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+/**
+ * Start an incremental CRC-64 checksum. Feed it data with crc64_update(), and
+ * get the checksum with crc64_final().
+ **/
+static inline uint64_t
+crc64_init(void)
+{
+	return 0;
+}
+
+/**
+ * Finish an incremental CRC-64 checksum. ECMA-182 has no final XOR, so the
+ * running value is the checksum.
+ **/
+static inline uint64_t
+crc64_final(uint64_t crc)
+{
+	return crc;
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 uint64_t crc64(unsigned char *data, size_t size);
+uint64_t crc64_update(uint64_t crc, const unsigned char *data, size_t size);
+uint64_t crc64_combine(uint64_t crc_a, uint64_t crc_b, size_t len_b);
+uint64_t crc64_parallel(const unsigned char *data, size_t size,
+			unsigned int threads);
+uint64_t crc64_update_table(uint64_t crc, const unsigned char *data,
+			    size_t size);
 uint64_t crc64_8h(uint64_t data);
+uint64_t crc64_bitwise(unsigned char *data, size_t size);
+uint64_t crc64_8h_bitwise(uint64_t data);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,306 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdlib.h>
+
+#include "expr.h"
+#include "value.h"
+#include "util.h"
+
+/**
+ * Allocate an expression node.
+ **/
+static struct expr *
+expr_alloc(enum expr_op op)
+{
+	struct expr *ret = xcalloc(1, sizeof(struct expr));
+
+	ret->op = op;
+	return ret;
+}
+
+/**
+ * Add an operand to an expression node.
+ **/
+static void
+expr_append(struct expr *expr, struct expr *arg)
+{
+	if (expr->count == expr->size) {
+		expr->size = expr->size ? expr->size * 2 : 4;
+		expr->args = xrealloc(expr->args,
+				      expr->size * sizeof(struct expr *));
+	}
+
+	expr->args[expr->count++] = arg;
+}
+
+/**
+ * Add an operand to an n-ary node. If the operand is the same operation, its
+ * operands are added instead.
+ **/
+static void
+expr_append_flat(struct expr *expr, struct expr *arg)
+{
+	size_t i;
+
+	if (arg->op != expr->op) {
+		expr_append(expr, arg);
+		return;
+	}
+
+	for (i = 0; i < arg->count; i++)
+		expr_append(expr, arg->args[i]);
+
+	arg->count = 0;
+	expr_destroy(arg);
+}
+
+/**
+ * Free an expression node, leaving its operands alone.
+ **/
+static void
+expr_free_node(struct expr *expr)
+{
+	free(expr->args);
+	free(expr);
+}
+
+/**
+ * Create an expression which yields a value. The expression takes ownership
+ * of the value.
+ **/
+struct expr *
+expr_create_value(ason_t *value)
+{
+	struct expr *ret = expr_alloc(EXPR_VALUE);
+
+	ret->value = value;
+	return ret;
+}
+
+/**
+ * Create an expression applying a unary operation.
+ **/
+struct expr *
+expr_create_unary(enum expr_op op, struct expr *a)
+{
+	struct expr *ret = expr_alloc(op);
+
+	expr_append(ret, a);
+	return ret;
+}
+
+/**
+ * Create an expression applying a binary operation. Unions and intersections
+ * are gathered into a single node as they are built, so a long chain of them
+ * does not produce a deep tree.
+ **/
+struct expr *
+expr_create_binary(enum expr_op op, struct expr *a, struct expr *b)
+{
+	struct expr *ret;
+
+	if (op != EXPR_UNION && op != EXPR_INTERSECT) {
+		ret = expr_alloc(op);
+		expr_append(ret, a);
+		expr_append(ret, b);
+		return ret;
+	}
+
+	if (a->op == op) {
+		ret = a;
+	} else {
+		ret = expr_alloc(op);
+		expr_append(ret, a);
+	}
+
+	expr_append_flat(ret, b);
+	return ret;
+}
+
+/**
+ * Free an expression and everything in it.
+ **/
+void
+expr_destroy(struct expr *expr)
+{
+	size_t i;
+
+	if (expr->op == EXPR_VALUE)
+		ason_destroy(expr->value);
+
+	for (i = 0; i < expr->count; i++)
+		expr_destroy(expr->args[i]);
+
+	expr_free_node(expr);
+}
+
+/**
+ * Check whether an expression is exactly the given constant.
+ **/
+static int
+expr_is(struct expr *expr, ason_t *value)
+{
+	return expr->op == EXPR_VALUE && expr->value == value;
+}
+
+/**
+ * Simplify a union or intersection. `absorb` is the value which absorbs the
+ * whole operation, and `identity` is the value which can be dropped from it.
+ **/
+static struct expr *
+expr_simplify_nary(struct expr *expr, ason_t *absorb, ason_t *identity)
+{
+	struct expr **args = expr->args;
+	size_t count = expr->count;
+	struct expr *ret;
+	size_t i;
+
+	expr->args = NULL;
+	expr->count = expr->size = 0;
+
+	for (i = 0; i < count; i++) {
+		if (expr_is(args[i], absorb))
+			break;
+
+		if (expr_is(args[i], identity))
+			expr_destroy(args[i]);
+		else
+			expr_append_flat(expr, args[i]);
+	}
+
+	if (i < count) {
+		ret = args[i];
+
+		while (++i < count)
+			expr_destroy(args[i]);
+
+		free(args);
+		expr_destroy(expr);
+		return ret;
+	}
+
+	free(args);
+
+	if (expr->count > 1)
+		return expr;
+
+	ret = expr->count ? expr->args[0] : expr_create_value(identity);
+	expr_free_node(expr);
+	return ret;
+}
+
+/**
+ * Simplify an expression tree before it is evaluated. Unions and
+ * intersections are flattened into single nodes, double complements cancel,
+ * and `U` or `_` operands either vanish or decide the whole operation.
+ **/
+struct expr *
+expr_simplify(struct expr *expr)
+{
+	struct expr *ret;
+	size_t i;
+
+	for (i = 0; i < expr->count; i++)
+		expr->args[i] = expr_simplify(expr->args[i]);
+
+	switch (expr->op) {
+	case EXPR_UNION:
+		return expr_simplify_nary(expr, ASON_UNIVERSE, ASON_EMPTY);
+	case EXPR_INTERSECT:
+		return expr_simplify_nary(expr, ASON_EMPTY, ASON_UNIVERSE);
+	case EXPR_COMPLEMENT:
+		if (expr->args[0]->op != EXPR_COMPLEMENT)
+			return expr;
+
+		ret = expr->args[0]->args[0];
+		expr_free_node(expr->args[0]);
+		expr_free_node(expr);
+		return ret;
+	default:
+		return expr;
+	}
+}
+
+/**
+ * Evaluate an expression tree.
+ **/
+ason_t *
+expr_eval(struct expr *expr)
+{
+	ason_t **values;
+	ason_t *ret;
+	size_t i;
+
+	if (expr->op == EXPR_VALUE)
+		return ason_copy(expr->value);
+
+	values = xcalloc(expr->count, sizeof(ason_t *));
+
+	for (i = 0; i < expr->count; i++)
+		values[i] = expr_eval(expr->args[i]);
+
+	switch (expr->op) {
+	case EXPR_UNION:
+		ret = ason_union_n(values, expr->count);
+		break;
+	case EXPR_INTERSECT:
+		ret = ason_intersect_n(values, expr->count);
+		break;
+	case EXPR_JOIN:
+		ret = ason_join(values[0], values[1]);
+		break;
+	case EXPR_COMPLEMENT:
+		ret = ason_complement(values[0]);
+		break;
+	case EXPR_REPR:
+		ret = ason_representation_in(values[0], values[1]);
+		break;
+	default:
+		ret = ason_equality(values[0], values[1]);
+	}
+
+	for (i = 0; i < expr->count; i++)
+		ason_destroy(values[i]);
+
+	free(values);
+	return ret;
+}
+
+/**
+ * Simplify and evaluate an expression tree, then free it.
+ **/
+ason_t *
+expr_eval_d(struct expr *expr)
+{
+	ason_t *ret;
+
+	expr = expr_simplify(expr);
+
+	if (expr->op == EXPR_VALUE) {
+		ret = expr->value;
+		expr_free_node(expr);
+		return ret;
+	}
+
+	ret = expr_eval(expr);
+	expr_destroy(expr);
+
+	return ret;
+}
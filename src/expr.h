@@ -0,0 +1,70 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <stddef.h>
+
+#include <ason/ason.h>
+
+/**
+ * Operations an expression node can perform.
+ **/
+enum expr_op {
+	EXPR_VALUE,
+	EXPR_UNION,
+	EXPR_INTERSECT,
+	EXPR_JOIN,
+	EXPR_COMPLEMENT,
+	EXPR_REPR,
+	EXPR_EQUAL,
+};
+
+/**
+ * A node in an expression tree. EXPR_VALUE nodes hold a value, and all others
+ * hold their operands in `args`. Union and intersection nodes take any number
+ * of operands, and the rest take one or two.
+ **/
+struct expr {
+	enum expr_op op;
+	ason_t *value;
+	struct expr **args;
+	size_t count;
+	size_t size;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct expr *expr_create_value(ason_t *value);
+struct expr *expr_create_unary(enum expr_op op, struct expr *a);
+struct expr *expr_create_binary(enum expr_op op, struct expr *a,
+				struct expr *b);
+void expr_destroy(struct expr *expr);
+struct expr *expr_simplify(struct expr *expr);
+ason_t *expr_eval(struct expr *expr);
+ason_t *expr_eval_d(struct expr *expr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EXPR_H */
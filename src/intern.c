@@ -0,0 +1,191 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <string.h>
+#include <pthread.h>
+
+#include "intern.h"
+#include "crc.h"
+#include "util.h"
+
+/**
+ * Number of slots the pool starts with. Always a power of two.
+ **/
+#define INTERN_MIN_SIZE 256
+
+/**
+ * The pool is an open addressing hash table with linear probing, shared by
+ * every thread and guarded by `intern_lock`.
+ **/
+static struct interned **intern_slots;
+static size_t intern_size;
+static size_t intern_count;
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Find the slot holding a string, or the empty slot where it belongs.
+ **/
+static size_t
+intern_find(uint64_t hash, const char *text, size_t length)
+{
+	size_t mask = intern_size - 1;
+	size_t i = hash & mask;
+	struct interned *str;
+
+	while ((str = intern_slots[i])) {
+		if (str->hash == hash && str->length == length &&
+		    ! memcmp(str->text, text, length))
+			break;
+
+		i = (i + 1) & mask;
+	}
+
+	return i;
+}
+
+/**
+ * Double the number of slots in the pool. Strings are placed by the hash they
+ * already carry, so nothing is hashed again.
+ **/
+static void
+intern_grow(void)
+{
+	struct interned **old = intern_slots;
+	size_t old_size = intern_size;
+	size_t mask;
+	size_t i;
+	size_t j;
+
+	intern_size = intern_size ? intern_size * 2 : INTERN_MIN_SIZE;
+	intern_slots = xcalloc(intern_size, sizeof(struct interned *));
+	mask = intern_size - 1;
+
+	for (i = 0; i < old_size; i++) {
+		if (! old[i])
+			continue;
+
+		for (j = old[i]->hash & mask; intern_slots[j]; j = (j + 1) & mask);
+
+		intern_slots[j] = old[i];
+	}
+
+	free(old);
+}
+
+/**
+ * Get the pooled copy of a string of `length` bytes, adding it to the pool if
+ * it is not there. The caller holds a reference to the result, which should be
+ * dropped with intern_release().
+ **/
+struct interned *
+intern(const char *text, size_t length)
+{
+	uint64_t hash = crc64((unsigned char *)text, length);
+	struct interned *ret;
+	size_t i;
+
+	pthread_mutex_lock(&intern_lock);
+
+	if ((intern_count + 1) * 4 > intern_size * 3)
+		intern_grow();
+
+	i = intern_find(hash, text, length);
+	ret = intern_slots[i];
+
+	if (ret) {
+		__atomic_add_fetch(&ret->refcount, 1, __ATOMIC_RELAXED);
+	} else {
+		ret = xmalloc(sizeof(struct interned) + length + 1);
+		ret->hash = hash;
+		ret->length = length;
+		ret->refcount = 1;
+		memcpy(ret->text, text, length);
+		ret->text[length] = '\0';
+
+		intern_slots[i] = ret;
+		intern_count++;
+	}
+
+	pthread_mutex_unlock(&intern_lock);
+
+	return ret;
+}
+
+/**
+ * Take another reference to an interned string. The caller already holds one,
+ * so the string cannot leave the pool and no lock is needed.
+ **/
+struct interned *
+intern_ref(struct interned *str)
+{
+	__atomic_add_fetch(&str->refcount, 1, __ATOMIC_RELAXED);
+	return str;
+}
+
+/**
+ * Drop a reference to an interned string. When the last reference goes, the
+ * string leaves the pool.
+ **/
+void
+intern_release(struct interned *str)
+{
+	size_t refcount = __atomic_load_n(&str->refcount, __ATOMIC_RELAXED);
+	size_t mask;
+	size_t home;
+	size_t i;
+	size_t j;
+
+	/* Only the last reference needs the lock, so intern() can't find the
+	 * string while we remove it. */
+	while (refcount > 1)
+		if (__atomic_compare_exchange_n(&str->refcount, &refcount,
+						refcount - 1, 0,
+						__ATOMIC_RELEASE,
+						__ATOMIC_RELAXED))
+			return;
+
+	pthread_mutex_lock(&intern_lock);
+
+	if (__atomic_sub_fetch(&str->refcount, 1, __ATOMIC_ACQ_REL)) {
+		pthread_mutex_unlock(&intern_lock);
+		return;
+	}
+
+	mask = intern_size - 1;
+	i = intern_find(str->hash, str->text, str->length);
+	intern_slots[i] = NULL;
+	intern_count--;
+
+	/* Move back any string after the gap whose probe would otherwise
+	 * stop at it before reaching the string. */
+	for (j = (i + 1) & mask; intern_slots[j]; j = (j + 1) & mask) {
+		home = intern_slots[j]->hash & mask;
+
+		if (i <= j ? (home > i && home <= j) : (home > i || home <= j))
+			continue;
+
+		intern_slots[i] = intern_slots[j];
+		intern_slots[j] = NULL;
+		i = j;
+	}
+
+	pthread_mutex_unlock(&intern_lock);
+
+	free(str);
+}
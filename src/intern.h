@@ -0,0 +1,52 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A string stored once in the intern pool. Every intern() of the same bytes
+ * returns the same pointer, so interned strings can be compared by pointer.
+ * `text` is terminated, but may also contain NULs within its `length` bytes.
+ * `hash` is computed once when the string is first interned.
+ **/
+struct interned {
+	uint64_t hash;
+	size_t length;
+	size_t refcount;
+	char text[];
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct interned *intern(const char *text, size_t length);
+struct interned *intern_ref(struct interned *str);
+void intern_release(struct interned *str);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INTERN_H */
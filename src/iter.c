@@ -47,7 +47,7 @@ ason_iterate(ason_t *value)
 API_EXPORT int
 ason_iter_enter(ason_iter_t *iter)
 {
-	(void)iter;
+	ason_materialize(iter->current);
 	return 0;
 }
 
@@ -0,0 +1,657 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <string.h>
+
+#include <ason/ason.h>
+#include <ason/read.h>
+#include <ason/print.h>
+
+#include "value.h"
+#include "buffer.h"
+#include "util.h"
+#include "stringfunc.h"
+#include "number.h"
+
+/**
+ * Deepest nesting of lists and objects we will decode.
+ **/
+#define JSON_MAX_DEPTH 512
+
+/**
+ * State of a JSON decode. When `lazy` is set, lists and objects nested
+ * `defer_depth` or more levels deep are not decoded, but recorded as a range
+ * of `lazy` to decode later.
+ **/
+struct json_parser {
+	const char *pos;
+	const char *end;
+	int depth;
+	struct lazy_source *lazy;
+	int defer_depth;
+};
+
+static ason_t *json_parse_value(struct json_parser *p);
+
+/**
+ * Skip whitespace as JSON defines it.
+ **/
+static inline void
+json_skip_space(struct json_parser *p)
+{
+	while (p->pos < p->end && (*p->pos == ' ' || *p->pos == '\n' ||
+				   *p->pos == '\r' || *p->pos == '\t'))
+		p->pos++;
+}
+
+/**
+ * Check whether the next non-whitespace character is `c`, and consume it if
+ * so.
+ **/
+static inline int
+json_expect(struct json_parser *p, char c)
+{
+	json_skip_space(p);
+
+	if (p->pos == p->end || *p->pos != c)
+		return 0;
+
+	p->pos++;
+	return 1;
+}
+
+/**
+ * Move past a string, checking its characters and escapes. `p->pos` should be
+ * on the opening quote. Set `escaped` if the string has escape sequences.
+ * Return 0 if the string is malformed.
+ **/
+static int
+json_scan_string(struct json_parser *p, int *escaped)
+{
+	const char *c;
+
+	*escaped = 0;
+
+	for (c = p->pos + 1; c < p->end && *c != '"'; c++) {
+		if ((unsigned char)*c < 0x20)
+			return 0;
+
+		if (*c != '\\')
+			continue;
+
+		if (++c == p->end || ! *c || ! strchr("\"\\/bfnrtu", *c))
+			return 0;
+
+		if (*c == 'u') {
+			c++;
+
+			if (string_read_u_escape(&c, p->end) < 0)
+				return 0;
+
+			c--;
+		}
+
+		*escaped = 1;
+	}
+
+	if (c == p->end)
+		return 0;
+
+	p->pos = c + 1;
+	return 1;
+}
+
+/**
+ * Decode a string. `p->pos` should be on the opening quote. Return NULL if
+ * the string is malformed.
+ **/
+static char *
+json_parse_string(struct json_parser *p)
+{
+	const char *start = p->pos + 1;
+	int escaped;
+
+	if (! json_scan_string(p, &escaped))
+		return NULL;
+
+	if (! escaped)
+		return xstrndup(start, p->pos - 1 - start);
+
+	return string_unescape(start, p->pos - 1 - start);
+}
+
+/**
+ * Decode a string and intern it. Strings without escapes are interned straight
+ * from the text. Return NULL if the string is malformed.
+ **/
+static struct interned *
+json_parse_key(struct json_parser *p)
+{
+	const char *start = p->pos + 1;
+	struct interned *ret;
+	char *str;
+	int escaped;
+
+	if (! json_scan_string(p, &escaped))
+		return NULL;
+
+	if (! escaped)
+		return intern(start, p->pos - 1 - start);
+
+	if (! (str = string_unescape(start, p->pos - 1 - start)))
+		return NULL;
+
+	ret = intern(str, strlen(str));
+	free(str);
+	return ret;
+}
+
+/**
+ * Decode a list. `p->pos` should be on the opening bracket.
+ **/
+static ason_t *
+json_parse_list(struct json_parser *p)
+{
+	struct list_builder *builder;
+	ason_t *item;
+
+	p->pos++;
+
+	if (json_expect(p, ']'))
+		return ason_create_list(NULL);
+
+	builder = list_builder_create();
+
+	do {
+		item = json_parse_value(p);
+
+		if (! item) {
+			list_builder_destroy(builder);
+			return NULL;
+		}
+
+		list_builder_append(builder, item);
+	} while (json_expect(p, ','));
+
+	if (! json_expect(p, ']')) {
+		list_builder_destroy(builder);
+		return NULL;
+	}
+
+	return list_builder_finish(builder);
+}
+
+/**
+ * Decode an object. `p->pos` should be on the opening brace.
+ **/
+static ason_t *
+json_parse_object(struct json_parser *p)
+{
+	struct object_builder *builder;
+	ason_t *value;
+	struct interned *key;
+
+	p->pos++;
+
+	if (json_expect(p, '}'))
+		return ason_create_object(NULL, NULL);
+
+	builder = object_builder_create();
+
+	do {
+		json_skip_space(p);
+
+		if (p->pos == p->end || *p->pos != '"')
+			goto fail;
+
+		key = json_parse_key(p);
+
+		if (! key)
+			goto fail;
+
+		if (! json_expect(p, ':') || ! (value = json_parse_value(p))) {
+			intern_release(key);
+			goto fail;
+		}
+
+		object_builder_append(builder, key, value);
+	} while (json_expect(p, ','));
+
+	if (json_expect(p, '}'))
+		return object_builder_finish(builder);
+
+fail:
+	object_builder_destroy(builder);
+	return NULL;
+}
+
+/**
+ * Decode one of the literal names `true`, `false` or `null`.
+ **/
+static ason_t *
+json_parse_literal(struct json_parser *p, const char *name, ason_t *value)
+{
+	size_t length = strlen(name);
+
+	if ((size_t)(p->end - p->pos) < length ||
+	    memcmp(p->pos, name, length))
+		return NULL;
+
+	p->pos += length;
+	return value;
+}
+
+/**
+ * Move past a value without decoding it, checking it as strictly as decoding
+ * would. Nothing is allocated. Return 0 if the value is malformed.
+ **/
+static int
+json_check_value(struct json_parser *p)
+{
+	char close;
+	int escaped;
+	int64_t n;
+	size_t got;
+
+	json_skip_space(p);
+
+	if (p->pos == p->end)
+		return 0;
+
+	switch (*p->pos) {
+	case '[':
+	case '{':
+		if (p->depth == JSON_MAX_DEPTH)
+			return 0;
+
+		close = *p->pos == '[' ? ']' : '}';
+		p->pos++;
+
+		if (json_expect(p, close))
+			return 1;
+
+		p->depth++;
+
+		do {
+			if (close == '}') {
+				json_skip_space(p);
+
+				if (p->pos == p->end || *p->pos != '"' ||
+				    ! json_scan_string(p, &escaped) ||
+				    ! json_expect(p, ':'))
+					return 0;
+			}
+
+			if (! json_check_value(p))
+				return 0;
+		} while (json_expect(p, ','));
+
+		p->depth--;
+		return json_expect(p, close);
+	case '"':
+		return json_scan_string(p, &escaped);
+	case 't':
+		return json_parse_literal(p, "true", ASON_TRUE) != NULL;
+	case 'f':
+		return json_parse_literal(p, "false", ASON_FALSE) != NULL;
+	case 'n':
+		return json_parse_literal(p, "null", ASON_NULL) != NULL;
+	default:
+		got = fixnum_parse(p->pos, p->end - p->pos, &n);
+		p->pos += got;
+		return got != 0;
+	}
+}
+
+/**
+ * Record a list or object to be decoded when it is first needed.
+ **/
+static ason_t *
+json_defer(struct json_parser *p)
+{
+	const char *start = p->pos;
+	ason_t *ret;
+
+	if (! json_check_value(p))
+		return NULL;
+
+	ret = xcalloc(1, sizeof(ason_t));
+	ret->refcount = 1;
+	ret->lazy = xmalloc(sizeof(struct ason_lazy));
+	ret->lazy->source = p->lazy;
+	ret->lazy->start = start - p->lazy->text;
+	ret->lazy->length = p->pos - start;
+	p->lazy->refcount++;
+
+	return ret;
+}
+
+/**
+ * Decode any JSON value.
+ **/
+static ason_t *
+json_parse_value(struct json_parser *p)
+{
+	ason_t *ret;
+	char *str;
+	int64_t n;
+	size_t got;
+
+	json_skip_space(p);
+
+	if (p->pos == p->end)
+		return NULL;
+
+	switch (*p->pos) {
+	case '[':
+	case '{':
+		if (p->lazy && p->depth >= p->defer_depth)
+			return json_defer(p);
+
+		if (p->depth == JSON_MAX_DEPTH)
+			return NULL;
+
+		p->depth++;
+
+		if (*p->pos == '[')
+			ret = json_parse_list(p);
+		else
+			ret = json_parse_object(p);
+
+		p->depth--;
+		return ret;
+	case '"':
+		str = json_parse_string(p);
+
+		if (! str)
+			return NULL;
+
+		ret = ason_create_string(str);
+		free(str);
+		return ret;
+	case 't':
+		return json_parse_literal(p, "true", ASON_TRUE);
+	case 'f':
+		return json_parse_literal(p, "false", ASON_FALSE);
+	case 'n':
+		return json_parse_literal(p, "null", ASON_NULL);
+	default:
+		got = fixnum_parse(p->pos, p->end - p->pos, &n);
+
+		if (! got)
+			return NULL;
+
+		p->pos += got;
+		return ason_create_fixnum(n);
+	}
+}
+
+/**
+ * Decode a value which must take up all of the parser's input.
+ **/
+static ason_t *
+json_parse_all(struct json_parser *p)
+{
+	ason_t *ret = json_parse_value(p);
+
+	if (! ret)
+		return NULL;
+
+	json_skip_space(p);
+
+	if (p->pos == p->end)
+		return ret;
+
+	ason_destroy(ret);
+	return NULL;
+}
+
+/**
+ * Drop a reference to the source text of lazily read values.
+ **/
+static void
+lazy_source_release(struct lazy_source *source)
+{
+	if (--source->refcount)
+		return;
+
+	free(source->text);
+	free(source);
+}
+
+/**
+ * Drop a lazily read value's hold on its source text.
+ **/
+void
+ason_lazy_release(struct ason_lazy *lazy)
+{
+	lazy_source_release(lazy->source);
+	free(lazy);
+}
+
+/**
+ * Decode a lazily read value in place. Lists and objects inside it are
+ * themselves left to be decoded later. The text was checked when it was read,
+ * so decoding it cannot fail.
+ **/
+void
+ason_lazy_decode(ason_t *value)
+{
+	struct ason_lazy *lazy = value->lazy;
+	const char *text = lazy->source->text + lazy->start;
+	struct json_parser p = {
+		.pos = text,
+		.end = text + lazy->length,
+		.depth = 0,
+		.lazy = lazy->source,
+		.defer_depth = 1,
+	};
+	ason_t *decoded = json_parse_all(&p);
+
+	value->lazy = NULL;
+
+	if (decoded) {
+		ason_materialize(decoded);
+		value->atoms = decoded->atoms;
+		value->num_dom = ason_num_dom_copy(decoded->num_dom);
+		value->str_dom = ason_str_dom_copy(decoded->str_dom);
+		ason_destroy(decoded);
+	}
+
+	ason_lazy_release(lazy);
+}
+
+/**
+ * Read a JSON document. Stop after `length` bytes.
+ **/
+API_EXPORT ason_t *
+ason_readn_json(const char *text, size_t length)
+{
+	struct json_parser p = {
+		.pos = text,
+		.end = text + length,
+		.depth = 0,
+		.lazy = NULL,
+	};
+
+	return json_parse_all(&p);
+}
+
+/**
+ * Read a JSON document.
+ **/
+API_EXPORT ason_t *
+ason_read_json(const char *text)
+{
+	return ason_readn_json(text, strlen(text));
+}
+
+/**
+ * Read a JSON document lazily. Stop after `length` bytes. Lists and objects
+ * are checked, but not decoded until something first looks inside them.
+ **/
+API_EXPORT ason_t *
+ason_readn_lazy(const char *text, size_t length)
+{
+	struct lazy_source *source = xmalloc(sizeof(struct lazy_source));
+	struct json_parser p;
+	ason_t *ret;
+
+	source->text = xmalloc(length + 1);
+	source->length = length;
+	source->refcount = 1;
+	memcpy(source->text, text, length);
+
+	p.pos = source->text;
+	p.end = source->text + length;
+	p.depth = 0;
+	p.lazy = source;
+	p.defer_depth = 0;
+
+	ret = json_parse_all(&p);
+	lazy_source_release(source);
+
+	return ret;
+}
+
+/**
+ * Read a JSON document lazily.
+ **/
+API_EXPORT ason_t *
+ason_read_lazy(const char *text)
+{
+	return ason_readn_lazy(text, strlen(text));
+}
+
+/**
+ * Write a decoded string with only the escapes JSON requires.
+ **/
+static void
+json_write_escaped(struct buffer *buf, const char *str, size_t length)
+{
+	const char *end = str + length;
+	const char *run = str;
+	char esc[7];
+
+	buffer_append(buf, "\"", 1);
+
+	for (; str < end; str++) {
+		if ((unsigned char)*str >= 0x20 && *str != '"' && *str != '\\')
+			continue;
+
+		buffer_append(buf, run, str - run);
+		run = str + 1;
+
+		switch (*str) {
+		case '"':
+			buffer_append(buf, "\\\"", 2);
+			break;
+		case '\\':
+			buffer_append(buf, "\\\\", 2);
+			break;
+		case '\b':
+			buffer_append(buf, "\\b", 2);
+			break;
+		case '\f':
+			buffer_append(buf, "\\f", 2);
+			break;
+		case '\n':
+			buffer_append(buf, "\\n", 2);
+			break;
+		case '\r':
+			buffer_append(buf, "\\r", 2);
+			break;
+		case '\t':
+			buffer_append(buf, "\\t", 2);
+			break;
+		default:
+			snprintf(esc, sizeof(esc), "\\u%04x", *str);
+			buffer_append(buf, esc, 6);
+		}
+	}
+
+	buffer_append(buf, run, str - run);
+	buffer_append(buf, "\"", 1);
+}
+
+/**
+ * Encode a value as JSON. The value must be a single number, a single string
+ * or a single one of `true`, `false` and `null`. Return 0 if the value has no
+ * JSON form.
+ **/
+static int
+json_write_ason(struct buffer *buf, ason_t *value)
+{
+	char number[FIXNUM_FORMAT_MAX];
+	ason_num_dom_t *dom;
+	ason_str_dom_t *str;
+
+	ason_materialize(value);
+	dom = value->num_dom;
+	str = value->str_dom;
+
+	if (str) {
+		if (value->atoms || dom || str->inverted || str->count != 1)
+			return 0;
+
+		json_write_escaped(buf, str->items[0]->text,
+				   str->items[0]->length);
+		return 1;
+	}
+
+	if (! dom) {
+		if (value->atoms == ATOM_TRUE)
+			buffer_append(buf, "true", 4);
+		else if (value->atoms == ATOM_FALSE)
+			buffer_append(buf, "false", 5);
+		else if (value->atoms == ATOM_NULL)
+			buffer_append(buf, "null", 4);
+		else
+			return 0;
+
+		return 1;
+	}
+
+	if (value->atoms || dom == ASON_NUM_DOM_UNIVERSE || dom->count != 1 ||
+	    dom->minus_inf || ! ((TWOBIT_GET(dom->states, 0) ^ dom->inv_bits) % 3))
+		return 0;
+
+	buffer_append(buf, number, fixnum_format(dom->items[0], number));
+	return 1;
+}
+
+/**
+ * Print an ASON value as JSON. Return NULL if the value is not a single JSON
+ * value. `flags` only affect the layout of lists and objects, which have no
+ * JSON form yet.
+ **/
+API_EXPORT char *
+ason_print_json(ason_t *value, int flags)
+{
+	ason_buffer_t buf = ASON_BUFFER_INIT;
+	struct buffer out = { .out = &buf };
+
+	(void)flags;
+
+	if (json_write_ason(&out, value))
+		return buf.data;
+
+	free(buf.data);
+	return NULL;
+}
@@ -75,15 +75,17 @@ ason_ns_create(const ason_ns_ops_t *ops, const char *setup)
 }
 
 /**
- * Find a subspace by the given name in the given namespace.
+ * Find a subspace by the given name in the given namespace. The name is
+ * `length` bytes long and need not be NUL-terminated.
  **/
-ason_ns_t *
-ason_ns_lookup_sub(const ason_ns_t *ns, const char *name)
+static ason_ns_t *
+ason_ns_lookup_subn(const ason_ns_t *ns, const char *name, size_t length)
 {
 	size_t i;
 
 	for (i = 0; i < ns->subns_count; i++)
-		if (! strcmp(ns->subns[i].name, name))
+		if (! strncmp(ns->subns[i].name, name, length) &&
+		    ! ns->subns[i].name[length])
 			break;
 
 	if (ns->subns_count == i)
@@ -92,6 +94,15 @@ ason_ns_lookup_sub(const ason_ns_t *ns, const char *name)
 	return ns->subns[i].space;
 }
 
+/**
+ * Find a subspace by the given name in the given namespace.
+ **/
+ason_ns_t *
+ason_ns_lookup_sub(const ason_ns_t *ns, const char *name)
+{
+	return ason_ns_lookup_subn(ns, name, strlen(name));
+}
+
 /**
  * Detach a subspace from its parent.
  **/
@@ -179,7 +190,7 @@ static ason_ns_t *
 ason_ns_resolve_subspaces(ason_ns_t *ns, const char **name)
 {
 	const char *test = *name;
-	char *tmp;
+	const char *start;
 
 	do {
 		while (*test && *test != '.')
@@ -188,13 +199,10 @@ ason_ns_resolve_subspaces(ason_ns_t *ns, const char **name)
 		if (! *test)
 			return ns;
 
-		tmp = xstrndup(*name, test - *name);
-		test++;
-		*name = test;
-
-		ns = ason_ns_lookup_sub(ns, tmp);
+		start = *name;
+		*name = ++test;
 
-		free(tmp);
+		ns = ason_ns_lookup_subn(ns, start, test - 1 - start);
 	} while (ns);
 
 	return NULL;
@@ -47,13 +47,13 @@ extern ason_num_dom_t ASON_NUM_DOM_UNIVERSE_DATA;
  **/
 #define TWOBIT_SET(_ptr, _pos, _val) ({	\
 	uint64_t *ptr = _ptr;		\
-	int val = _val;			\
+	uint64_t val = _val;		\
 	size_t pos = _pos;		\
 \
 	ptr += pos / 32;		\
 	pos %= 32;			\
 \
-	*ptr &= ~(3 << (pos * 2));	\
+	*ptr &= ~(3ULL << (pos * 2));	\
 	*ptr |= val << (pos * 2);	\
 })
 
@@ -0,0 +1,401 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <string.h>
+#include <stdint.h>
+#include <endian.h>
+
+#include "number.h"
+#include "util.h"
+
+#define IS_DIGIT(c) ((unsigned char)((c) - '0') < 10)
+
+#ifdef __SIZEOF_INT128__
+
+/**
+ * A decimal mantissa. A halfway point between two fixed point values never
+ * has more than 32 significant digits, so keeping 33 lets us round exactly
+ * while leaving room to scale by FP_BITS without overflowing.
+ **/
+typedef unsigned __int128 mantissa_t;
+#define MAX_DIGITS 33
+
+#else
+
+typedef uint64_t mantissa_t;
+#define MAX_DIGITS 19
+
+#endif
+
+#define P19(x) ((mantissa_t)10000000000000000000ULL * (x))
+
+/**
+ * Powers of ten which fit in a mantissa.
+ **/
+static const mantissa_t pow10_table[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+	100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+	100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+	100000000000000000ULL, 1000000000000000000ULL,
+	10000000000000000000ULL,
+#ifdef __SIZEOF_INT128__
+	P19(10ULL), P19(100ULL), P19(1000ULL), P19(10000ULL),
+	P19(100000ULL), P19(1000000ULL), P19(10000000ULL),
+	P19(100000000ULL), P19(1000000000ULL), P19(10000000000ULL),
+	P19(100000000000ULL), P19(1000000000000ULL),
+	P19(10000000000000ULL), P19(100000000000000ULL),
+	P19(1000000000000000ULL), P19(10000000000000000ULL),
+	P19(100000000000000000ULL), P19(1000000000000000000ULL),
+	P19(10000000000000000000ULL),
+#endif
+};
+
+#undef P19
+
+#define POW10_MAX ((int)(sizeof(pow10_table) / sizeof(pow10_table[0])) - 1)
+
+/**
+ * Every two-digit decimal number, so we can print two digits at a time.
+ **/
+static const char digit_pairs[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233"
+	"34353637383940414243444546474849505152535455565758596061626364656667"
+	"6869707172737475767778798081828384858687888990919293949596979899";
+
+/**
+ * Most fractional digits we ever need to print. Numbers 10^-5 apart are closer
+ * together than fixed point values, so one of them always reads back as the
+ * value we started with.
+ **/
+#define FRAC_DIGITS_MAX 5
+
+/**
+ * A decimal number as it is being read: mantissa * 10^exp. `sticky` is set if
+ * nonzero digits were dropped because the mantissa was full.
+ **/
+struct decimal {
+	mantissa_t mantissa;
+	int exp;
+	int sticky;
+};
+
+/**
+ * Check whether 8 bytes packed little-endian into a word are all digits.
+ **/
+static inline int
+swar_is_eight_digits(uint64_t v)
+{
+	return ((v & 0xF0F0F0F0F0F0F0F0ULL) |
+		(((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+		0x3333333333333333ULL;
+}
+
+/**
+ * Convert 8 digits packed little-endian into a word to their value, combining
+ * adjacent pairs of digits, then pairs of pairs, and so on.
+ **/
+static inline uint32_t
+swar_parse_eight_digits(uint64_t v)
+{
+	v = ((v & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+	v = ((v & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+	return ((v & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+}
+
+/**
+ * Read a run of digits into a decimal. `frac` indicates we are past the
+ * decimal point. Return a pointer past the last digit.
+ **/
+static const char *
+decimal_read_digits(struct decimal *dec, const char *text, const char *end,
+		    int frac)
+{
+	const mantissa_t eight_limit = pow10_table[MAX_DIGITS - 8];
+	const mantissa_t one_limit = pow10_table[MAX_DIGITS - 1];
+	uint64_t word;
+
+	while (end - text >= 8 && dec->mantissa < eight_limit) {
+		memcpy(&word, text, 8);
+		word = le64toh(word);
+
+		if (! swar_is_eight_digits(word))
+			break;
+
+		dec->mantissa = dec->mantissa * 100000000 +
+			swar_parse_eight_digits(word);
+		dec->exp -= frac ? 8 : 0;
+		text += 8;
+	}
+
+	for (; text < end && IS_DIGIT(*text); text++) {
+		if (dec->mantissa < one_limit) {
+			dec->mantissa = dec->mantissa * 10 + (*text - '0');
+			dec->exp -= frac;
+			continue;
+		}
+
+		if (*text != '0')
+			dec->sticky = 1;
+
+		dec->exp += !frac;
+	}
+
+	return text;
+}
+
+#ifdef __SIZEOF_INT128__
+
+/**
+ * Scale a decimal into fixed point, rounding to nearest with ties to even.
+ * Return 0 if the result would overflow.
+ **/
+static int
+decimal_to_fixnum(const struct decimal *dec, uint64_t *out)
+{
+	mantissa_t scaled;
+	mantissa_t p;
+	mantissa_t q;
+	mantissa_t r;
+
+	if (! dec->mantissa) {
+		*out = 0;
+		return 1;
+	}
+
+	if (dec->exp >= 0) {
+		if (dec->exp > 19 || dec->mantissa > INT64_MAX)
+			return 0;
+
+		scaled = dec->mantissa * pow10_table[dec->exp];
+
+		if (scaled > INT64_MAX / FP_BITS)
+			return 0;
+
+		*out = scaled * FP_BITS;
+		return 1;
+	}
+
+	/* The mantissa times FP_BITS is below 10^38, so anything divided by
+	 * more than that rounds to zero. */
+	if (-dec->exp > POW10_MAX) {
+		*out = 0;
+		return 1;
+	}
+
+	/* When digits were dropped we kept at least 17 after the point, so
+	 * the halfway point is exact in the mantissa, and the dropped digits
+	 * only matter for breaking ties. */
+	scaled = dec->mantissa * FP_BITS;
+	p = pow10_table[-dec->exp];
+	q = scaled / p;
+	r = scaled % p;
+
+	if (r > p - r || (r == p - r && (dec->sticky || (q & 1))))
+		q++;
+
+	if (q > INT64_MAX)
+		return 0;
+
+	*out = q;
+	return 1;
+}
+
+#else
+
+/**
+ * Scale a decimal into fixed point. Without 128-bit integers we settle for
+ * extended precision floating point. Return 0 if the result would overflow.
+ **/
+static int
+decimal_to_fixnum(const struct decimal *dec, uint64_t *out)
+{
+	long double val = dec->mantissa;
+	int exp = dec->exp;
+
+	for (; exp > 0 && val < INT64_MAX; exp--)
+		val *= 10;
+	for (; exp < 0 && val; exp++)
+		val /= 10;
+
+	val = val * FP_BITS + 0.5L;
+
+	if (val >= INT64_MAX)
+		return 0;
+
+	*out = val;
+	return 1;
+}
+
+#endif
+
+/**
+ * Parse a JSON number into a fixed point value. Return the number of bytes
+ * consumed, or 0 if the text is not a number or the number does not fit.
+ **/
+size_t
+fixnum_parse(const char *text, size_t length, int64_t *out)
+{
+	const char *end = text + length;
+	const char *pos = text;
+	const char *start;
+	struct decimal dec = { .mantissa = 0, .exp = 0, .sticky = 0 };
+	int negative = 0;
+	int exp_negative = 0;
+	int exp = 0;
+	uint64_t magnitude;
+
+	if (pos < end && *pos == '-') {
+		negative = 1;
+		pos++;
+	}
+
+	if (pos == end || ! IS_DIGIT(*pos))
+		return 0;
+
+	if (*pos == '0') {
+		pos++;
+
+		if (pos < end && IS_DIGIT(*pos))
+			return 0;
+	} else {
+		pos = decimal_read_digits(&dec, pos, end, 0);
+	}
+
+	if (pos < end && *pos == '.') {
+		start = ++pos;
+		pos = decimal_read_digits(&dec, pos, end, 1);
+
+		if (pos == start)
+			return 0;
+	}
+
+	if (pos < end && (*pos == 'e' || *pos == 'E')) {
+		pos++;
+
+		if (pos < end && (*pos == '+' || *pos == '-'))
+			exp_negative = *(pos++) == '-';
+
+		for (start = pos; pos < end && IS_DIGIT(*pos); pos++)
+			if (exp < 100000)
+				exp = exp * 10 + (*pos - '0');
+
+		if (pos == start)
+			return 0;
+
+		dec.exp += exp_negative ? -exp : exp;
+	}
+
+	if (! decimal_to_fixnum(&dec, &magnitude))
+		return 0;
+
+	*out = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+	return pos - text;
+}
+
+/**
+ * Print the decimal digits of an integer into `out`, which must have room for
+ * 20 digits. Return the number of digits.
+ **/
+static size_t
+format_digits(uint64_t value, char *out)
+{
+	char tmp[20];
+	char *pos = tmp + sizeof(tmp);
+	size_t length;
+
+	while (value >= 100) {
+		pos -= 2;
+		memcpy(pos, digit_pairs + (value % 100) * 2, 2);
+		value /= 100;
+	}
+
+	if (value >= 10) {
+		pos -= 2;
+		memcpy(pos, digit_pairs + value * 2, 2);
+	} else {
+		*--pos = '0' + value;
+	}
+
+	length = tmp + sizeof(tmp) - pos;
+	memcpy(out, pos, length);
+	return length;
+}
+
+/**
+ * Check whether `digits` taken as a fraction with `count` decimal places reads
+ * back as the fixed point fraction `frac`, rounding as fixnum_parse() does.
+ **/
+static int
+frac_round_trips(uint64_t digits, int count, uint64_t frac)
+{
+	uint64_t scaled = digits * FP_BITS;
+	uint64_t p = pow10_table[count];
+	uint64_t q = scaled / p;
+	uint64_t r = scaled % p;
+
+	if (r > p - r || (r == p - r && (q & 1)))
+		q++;
+
+	return q == frac;
+}
+
+/**
+ * Print a fixed point value in decimal, using the fewest fractional digits
+ * that read back as the same value. `out` must have room for
+ * FIXNUM_FORMAT_MAX bytes. Return the length printed, not counting the
+ * terminating NUL.
+ **/
+size_t
+fixnum_format(int64_t value, char *out)
+{
+	uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+	uint64_t frac = magnitude % FP_BITS;
+	uint64_t digits = 0;
+	char *pos = out;
+	int count;
+	int i;
+
+	if (value < 0)
+		*pos++ = '-';
+
+	pos += format_digits(magnitude / FP_BITS, pos);
+
+	for (count = 0; frac && count < FRAC_DIGITS_MAX; ) {
+		count++;
+		digits = (frac * pow10_table[count] + FP_BITS / 2) / FP_BITS;
+
+		if (frac_round_trips(digits, count, frac))
+			break;
+	}
+
+	if (count) {
+		*pos++ = '.';
+
+		for (i = count - 1; i >= 0; i--) {
+			pos[i] = '0' + digits % 10;
+			digits /= 10;
+		}
+
+		pos += count;
+	}
+
+	*pos = '\0';
+	return pos - out;
+}
@@ -0,0 +1,42 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Longest text fixnum_format() produces, including the terminating NUL.
+ **/
+#define FIXNUM_FORMAT_MAX 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t fixnum_parse(const char *text, size_t length, int64_t *out);
+size_t fixnum_format(int64_t value, char *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NUMBER_H */
@@ -22,78 +22,133 @@
 #include <string.h>
 #include <limits.h>
 #include <err.h>
+#include <errno.h>
+#include <sys/uio.h>
 
 #include <ason/ason.h>
 #include <ason/print.h>
 
 #include "value.h"
+#include "buffer.h"
 #include "num_domain.h"
+#include "str_domain.h"
+#include "number.h"
 #include "util.h"
 #include "stringfunc.h"
 
 /**
- * Print just the atom values of an ASON value.
+ * Print just the atom values of an ASON value. Return whether anything was
+ * printed.
  **/
-static char *
-ason_do_asprint_atoms(ason_t *value)
+static int
+ason_print_atoms(struct buffer *buf, ason_t *value)
 {
-	char *vals[3];
-	size_t num = 0;
-
-	if (! value->atoms)
-		return NULL;
-
-	if (value->atoms & ATOM_TRUE)
-		vals[num++] = "true";
-	if (value->atoms & ATOM_FALSE)
-		vals[num++] = "false";
-	if (value->atoms & ATOM_NULL)
-		vals[num++] = "null";
-
-	if (num == 3)
-		return xstrdup("true | false | null");
-	if (num == 2)
-		return xasprintf("%s | %s", vals[0], vals[1]);
-	return xstrdup(vals[0]);
+	const char *sep = "";
+
+	if (value->atoms & ATOM_TRUE) {
+		buffer_puts(buf, "true");
+		sep = " | ";
+	}
+
+	if (value->atoms & ATOM_FALSE) {
+		buffer_puts(buf, sep);
+		buffer_puts(buf, "false");
+		sep = " | ";
+	}
+
+	if (value->atoms & ATOM_NULL) {
+		buffer_puts(buf, sep);
+		buffer_puts(buf, "null");
+	}
+
+	return value->atoms != 0;
 }
 
 /**
- * Print an ASON value as a string. Flag indicates if unicode should be used.
+ * Print a string value, quoted and escaped.
  **/
-static char *
-ason_do_asprint(ason_t *value, int unicode)
+static void
+ason_print_string(struct buffer *buf, struct interned *str)
+{
+	buffer_puts(buf, "\"");
+	string_escape_to_buffer(buf, str->text, str->length);
+	buffer_puts(buf, "\"");
+}
+
+/**
+ * Print just the string values of an ASON value. `printed` indicates whether
+ * anything was printed before them. Return whether anything has been printed
+ * now.
+ **/
+static int
+ason_print_strings(struct buffer *buf, ason_t *value, int printed,
+		   int unicode)
+{
+	ason_str_dom_t *dom = value->str_dom;
+	size_t i;
+
+	if (! dom)
+		return printed;
+
+	if (printed)
+		buffer_puts(buf, unicode ? " ∪ " : " | ");
+
+	if (dom->inverted)
+		buffer_puts(buf, "STRINGS");
+
+	for (i = 0; i < dom->count; i++) {
+		if (dom->inverted)
+			buffer_puts(buf, unicode ? "∩!" : "&!");
+		else if (i)
+			buffer_puts(buf, unicode ? " ∪ " : " | ");
+
+		ason_print_string(buf, dom->items[i]);
+	}
+
+	return 1;
+}
+
+/**
+ * Print an ASON value to the end of a buffer. Flag indicates if unicode
+ * should be used.
+ **/
+static void
+ason_do_print(struct buffer *buf, ason_t *value, int unicode)
 {
 	size_t i;
-	char *tmp;
-	char *ret = ason_do_asprint_atoms(value);
-	char *prefix;
-	char *sep;
-	char *oper;
-	ason_num_dom_t *dom = value->num_dom;
+	const char *sep;
+	const char *oper;
+	char number[FIXNUM_FORMAT_MAX];
+	ason_num_dom_t *dom;
+	int printed;
 	int state;
 	int elem_state;
 
+	ason_materialize(value);
+	printed = ason_print_atoms(buf, value);
+	printed = ason_print_strings(buf, value, printed, unicode);
+	dom = value->num_dom;
+
 	if (value->num_dom == NULL) {
-		if (ret)
-			return ret;
-		return xstrdup(unicode ? "∅" : "_");
+		if (! printed)
+			buffer_puts(buf, unicode ? "∅" : "_");
+		return;
 	}
 
 	if (value->num_dom == ASON_NUM_DOM_UNIVERSE) {
-		if (! ret)
-			return xstrdup("NUMBERS");
+		if (printed)
+			buffer_puts(buf, " | ");
 
-		return xasprintf("%s | NUMBERS", ret);
+		buffer_puts(buf, "NUMBERS");
+		return;
 	}
 
 	state = dom->minus_inf;
 
 	for (i = 0; i < dom->count; i++) {
-		tmp = ret;
-		prefix = ret ?: "";
 		elem_state = TWOBIT_GET(dom->states, i) ^ dom->inv_bits;
 
-		if (! ret)
+		if (! printed)
 			sep = "";
 		else if (i && state)
 			sep = unicode ? "∩" : "&";
@@ -110,13 +165,71 @@ ason_do_asprint(ason_t *value, int unicode)
 		if ((elem_state % 3) == 0)
 			state = !state;
 
-		ret = xasprintf("%s%s%s%d", prefix, sep, oper,
-				FP_WHOLE(dom->items[i]));
-		free(tmp);
+		buffer_puts(buf, sep);
+		buffer_puts(buf, oper);
+		buffer_append(buf, number,
+			      fixnum_format(dom->items[i], number));
+		printed = 1;
 	}
 
-	if (! ret)
+	if (! printed)
 		errx(1, "ason_asprint did not generate a string");
+}
+
+/**
+ * Size of the buffer used when streaming output.
+ **/
+#define STREAM_BUFFER_SIZE 4096
+
+/**
+ * Print an ASON value to the end of a buffer supplied by the caller. Return
+ * the number of bytes added.
+ **/
+API_EXPORT size_t
+ason_print_to_buffer(ason_buffer_t *buf, ason_t *value, int flags)
+{
+	struct buffer out = { .out = buf };
+	size_t start = buf->length;
+
+	ason_do_print(&out, value, flags & ASON_PRINT_UNICODE);
+	return buf->length - start;
+}
+
+/**
+ * Print an ASON value into a buffer of `len` bytes. Text which does not fit
+ * is dropped, and the output is always terminated if `len` is not 0. Return
+ * the length of the full output, not counting the terminating NUL.
+ **/
+API_EXPORT size_t
+ason_snprint(char *str, size_t len, ason_t *value, int flags)
+{
+	ason_buffer_t buf = { str, 0, len };
+	struct buffer out = { .out = &buf, .truncate = 1 };
+
+	if (len)
+		str[0] = '\0';
+
+	ason_do_print(&out, value, flags & ASON_PRINT_UNICODE);
+	return buf.length + out.written;
+}
+
+/**
+ * Print an ASON value into a new string. Most values fit a small buffer on
+ * the stack, which measures the output for us while we're at it. Anything
+ * larger is printed again into an allocation of exactly the right size.
+ **/
+static char *
+ason_do_asprint(ason_t *value, int flags)
+{
+	char small[256];
+	size_t len = ason_snprint(small, sizeof(small), value, flags);
+	char *ret;
+
+	if (len < sizeof(small))
+		return xmemdup(small, len + 1);
+
+	ret = xmalloc(len + 1);
+	ason_snprint(ret, len + 1, value, flags);
 	return ret;
 }
 
@@ -135,5 +248,89 @@ ason_asprint(ason_t *value)
 API_EXPORT char *
 ason_asprint_unicode(ason_t *value)
 {
-	return ason_do_asprint(value, 1);
+	return ason_do_asprint(value, ASON_PRINT_UNICODE);
+}
+
+/**
+ * Flush streamed output to a file descriptor, retrying short writes.
+ **/
+static int
+ason_stream_fd(struct buffer *buf, struct iovec *iov, int count)
+{
+	ssize_t got;
+
+	while (count) {
+		got = writev(buf->fd, iov, count);
+
+		if (got < 0 && errno == EINTR)
+			continue;
+
+		if (got < 0)
+			return -1;
+
+		for (; count && (size_t)got >= iov->iov_len; iov++, count--)
+			got -= iov->iov_len;
+
+		if (count) {
+			iov->iov_base = (char *)iov->iov_base + got;
+			iov->iov_len -= got;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Flush streamed output to a stdio stream.
+ **/
+static int
+ason_stream_file(struct buffer *buf, struct iovec *iov, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		if (fwrite(iov[i].iov_base, 1, iov[i].iov_len, buf->file) !=
+		    iov[i].iov_len)
+			return -1;
+
+	return 0;
+}
+
+/**
+ * Print an ASON value through a fixed size buffer. Return the number of bytes
+ * written, or -1 if a write failed.
+ **/
+static ssize_t
+ason_stream(struct buffer *out, ason_t *value)
+{
+	char data[STREAM_BUFFER_SIZE];
+	ason_buffer_t buf = { data, 0, sizeof(data) };
+
+	out->out = &buf;
+	ason_do_print(out, value, 0);
+	buffer_flush(out);
+
+	return out->failed ? -1 : (ssize_t)out->written;
+}
+
+/**
+ * Print an ASON value to a stdio stream.
+ **/
+API_EXPORT ssize_t
+ason_fprint(FILE *file, ason_t *value)
+{
+	struct buffer out = { .flush = ason_stream_file, .file = file };
+
+	return ason_stream(&out, value);
+}
+
+/**
+ * Print an ASON value to a file descriptor.
+ **/
+API_EXPORT ssize_t
+ason_write(int fd, ason_t *value)
+{
+	struct buffer out = { .flush = ason_stream_fd, .fd = fd };
+
+	return ason_stream(&out, value);
 }
@@ -24,26 +24,61 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <stdarg.h>
 
 #include "value.h"
+#include "expr.h"
+#include "symtab.h"
+#include "util.h"
 
 typedef union {
 	int64_t n;
 	char *c;
 	ason_t *value;
+	struct interned *sym;
 } token_t;
 
 /**
- * Output data.
+ * Output data. `symbols` caches the value of each symbol loaded so far. If
+ * `borrowed` is set, string tokens belong to someone else and are not freed.
+ * If `check` is set, we are only checking syntax, so symbols are neither
+ * loaded nor assigned.
  **/
 struct parse_data {
 	ason_t *ret;
 	ason_ns_t *ns;
 	int failed;
+	int borrowed;
+	int check;
+	struct symtab *symbols;
 };
 
+/**
+ * Get the value of a symbol. Each symbol is loaded from the namespace the
+ * first time it is mentioned, and the value is reused for the rest of the
+ * parse.
+ **/
+static ason_t *
+parse_load_symbol(struct parse_data *data, struct interned *name)
+{
+	struct symbol *sym;
+
+	if (data->check)
+		return ASON_EMPTY;
+
+	if (! data->symbols)
+		data->symbols = symtab_create();
+
+	sym = symtab_get(data->symbols, name);
+
+	if (! sym->value)
+		sym->value = ason_ns_load(data->ns, name->text) ?: ASON_EMPTY;
+
+	return ason_copy(sym->value);
+}
+
 /* Lemon has a problem with these */
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #pragma GCC diagnostic ignored "-Wunused-variable"
@@ -66,72 +101,79 @@ struct parse_data {
 %left COMMA.
 
 %type value     {ason_t *}
-%type list      {ason_t *}
-%type kv_list   {ason_t *}
-%type kv_pair   {ason_t *}
-%type join    {ason_t *}
-%type intersect {ason_t *}
-%type union     {ason_t *}
-%type comp      {ason_t *}
-%type equality  {ason_t *}
-%type repr      {ason_t *}
+%type list      {struct list_builder *}
+%type kv_list   {struct object_builder *}
+%type kv_pair   {struct kv_pair}
+%type join      {struct expr *}
+%type intersect {struct expr *}
+%type union     {struct expr *}
+%type comp      {struct expr *}
+%type equality  {struct expr *}
+%type repr      {struct expr *}
 
 %destructor value     { ason_destroy($$); }
-%destructor list      { ason_destroy($$); }
-%destructor kv_list   { ason_destroy($$); }
-%destructor kv_pair   { ason_destroy($$); }
-%destructor join      { ason_destroy($$); }
-%destructor intersect { ason_destroy($$); }
-%destructor union     { ason_destroy($$); }
-%destructor comp      { ason_destroy($$); }
-%destructor equality  { ason_destroy($$); }
-%destructor repr      { ason_destroy($$); }
+%destructor list      { list_builder_destroy($$); }
+%destructor kv_list   { object_builder_destroy($$); }
+%destructor kv_pair   { intern_release($$.key); ason_destroy($$.value); }
+%destructor join      { expr_destroy($$); }
+%destructor intersect { expr_destroy($$); }
+%destructor union     { expr_destroy($$); }
+%destructor comp      { expr_destroy($$); }
+%destructor equality  { expr_destroy($$); }
+%destructor repr      { expr_destroy($$); }
 
 %name asonLemon
 %token_prefix ASON_LEX_
 
 assignment ::= result.
 assignment ::= SYMBOL(A) ASSIGN result.			{
-	int i = ason_ns_mkvar(data->ns, A.c);
+	int i;
 
-	if (!i || i == -EEXIST)
-		ason_ns_store(data->ns, A.c, data->ret);
-	else
-		data->failed = 1;
+	if (! data->check) {
+		i = ason_ns_mkvar(data->ns, A.sym->text);
 
-	free(A.c);
+		if (!i || i == -EEXIST)
+			ason_ns_store(data->ns, A.sym->text, data->ret);
+		else
+			data->failed = 1;
+	}
 }
 
-result ::= equality(A). { data->ret = A; }
+result ::= equality(A). { data->ret = expr_eval_d(A); }
+
+/* ELEMENT is never lexed. The parallel reader feeds it first so each slice
+ * only accepts what may appear as a list element. */
+assignment ::= ELEMENT union(A). { data->ret = expr_eval_d(A); }
 
 equality(A) ::= repr(B).				{ A = B; }
 equality(A) ::= equality(B) EQUAL repr(C).		{
-	A = ason_equality_d(B, C);
+	A = expr_create_binary(EXPR_EQUAL, B, C);
 }
 
 repr(A) ::= union(B).					{ A = B; }
 repr(A) ::= repr(B) REPR union(C).		{
-	A = ason_representation_in_d(B, C);
+	A = expr_create_binary(EXPR_REPR, B, C);
 }
 
 
 union(A) ::= intersect(B).				{ A = B; }
 union(A) ::= union(B) UNION intersect(C).	{
-	A = ason_union_d(B, C);
+	A = expr_create_binary(EXPR_UNION, B, C);
 }
 
 intersect(A) ::= join(B).				{ A = B; }
 intersect(A) ::= intersect(B) INTERSECT join(C).	{
-	A = ason_intersect_d(B, C);
+	A = expr_create_binary(EXPR_INTERSECT, B, C);
 }
 
 join(A) ::= comp(B).				{ A = B; }
 join(A) ::= join(B) COLON comp(C).		{
-	A = ason_join_d(B, C);
+	A = expr_create_binary(EXPR_JOIN, B, C);
 }
 
-comp(A) ::= value(B). { A = B; }
-comp(A) ::= NOT comp(B). { A = ason_complement_d(B); }
+comp(A) ::= value(B). { A = expr_create_value(B); }
+comp(A) ::= NOT comp(B). { A = expr_create_unary(EXPR_COMPLEMENT, B); }
+comp(A) ::= O_PAREN equality(B) C_PAREN. { A = B; }
 
 value(A) ::= PREBAKED(B).	{ A = B.value; }
 value(A) ::= EMPTY.		{ A = ASON_EMPTY; }
@@ -145,44 +187,56 @@ value(A) ::= START_LIST END_LIST.			{
 	A = ason_create_list(NULL);
 }
 
-value(A) ::= START_LIST list(B) END_LIST.		{ A = B; }
+value(A) ::= START_LIST list(B) END_LIST.		{
+	A = list_builder_finish(B);
+}
+
 value(A) ::= TRUE.					{ A = ASON_TRUE; }
 value(A) ::= FALSE.					{ A = ASON_FALSE; }
 value(A) ::= START_OBJ END_OBJ.				{
 	A = ason_create_object(NULL,NULL);
 }
 
-value(A) ::= START_OBJ kv_list(B) END_OBJ.		{ A = B; }
+value(A) ::= START_OBJ kv_list(B) END_OBJ.		{
+	A = object_builder_finish(B);
+}
 value(A) ::= START_OBJ kv_list(B) COMMA WILD END_OBJ.	{
-	A = ason_join_d(B, ASON_OBJ_ANY);
+	A = ason_join_d(object_builder_finish(B), ASON_OBJ_ANY);
 }
 value(A) ::= START_OBJ WILD END_OBJ.			{ A = ASON_OBJ_ANY; }
 value(A) ::= STRING(B). {
 	A = ason_create_string(B.c);
-	free(B.c);
-}
 
-value(A) ::= O_PAREN equality(B) C_PAREN. { A = B; }
-value(A) ::= SYMBOL(B). {
-	if (data->ns)
-		A = ason_ns_load(data->ns, B.c) ?: ASON_EMPTY;
-	else
-		A = ASON_EMPTY;
+	if (! data->borrowed)
+		free(B.c);
 }
 
-list(A) ::= union(B).				{ A = ason_create_list_d(B); }
-list(A) ::= union(B) COMMA list(C).		{
-	A = ason_append_lists_d(ason_create_list_d(B), C);
+value(A) ::= SYMBOL(B). { A = parse_load_symbol(data, B.sym); }
+
+list(A) ::= union(B).				{
+	A = list_builder_create();
+	list_builder_append(A, expr_eval_d(B));
+}
+list(A) ::= list(B) COMMA union(C).		{
+	A = B;
+	list_builder_append(A, expr_eval_d(C));
 }
 
 kv_pair(A) ::= STRING(B) COLON union(C).	{
-	A = ason_create_object_d(B.c, C);
-	free(B.c);
+	A.key = intern(B.c, strlen(B.c));
+
+	if (! data->borrowed)
+		free(B.c);
+	A.value = expr_eval_d(C);
 }
 
-kv_list(A) ::= kv_pair(B).			{ A = B; }
+kv_list(A) ::= kv_pair(B).			{
+	A = object_builder_create();
+	object_builder_append(A, B.key, B.value);
+}
 kv_list(A) ::= kv_list(B) COMMA kv_pair(C).	{
-	A = ason_join_d(B, C);
+	A = B;
+	object_builder_append(A, C.key, C.value);
 }
 
 %code {
@@ -190,10 +244,17 @@ kv_list(A) ::= kv_list(B) COMMA kv_pair(C).	{
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
 
 #include "parse.h"
 #include "util.h"
 #include "stringfunc.h"
+#include "scan.h"
+#include "number.h"
 
 /**
  * Get a number token.
@@ -202,131 +263,135 @@ static const char *
 ason_get_token_number(const char *text, size_t length, int *type,
 		      token_t *data)
 {
-	const char *text_start;
-	int negator = 1;
-	size_t decimal_places = 0;
-	size_t decimal_inc = 0;
-	size_t digits = 0;
-	int64_t accum = 0;
+	size_t got = fixnum_parse(text, length, &data->n);
 
-	if (! length)
+	if (! got)
 		return text;
 
-	text_start = text;
-
-	if (*text == '-') {
-		negator = -1;
-		text++;
-		length--;
-	}
-
-	if (! length)
-		return text_start;
-
-	if (length < 2 && *text == 0)
-		return text_start;
-
-	if (text[0] == '0' && text[1] != '.')
-		return text_start;
+	*type = ASON_LEX_NUMBER;
+	return text + got;
+}
 
-	for (; length; length--, text++) {
-		if (*text == '.') {
-			if (decimal_inc)
-				return text_start;
-			decimal_inc = 1;
-			continue;
-		} else if (! isdigit(*text)) {
-			break;
-		}
+/**
+ * Pseudo-token the tokenizer emits for a positional argument. `data.n` holds
+ * the argument's format character, and it is replaced by a real token once
+ * the argument itself is known.
+ **/
+#define ASON_LEX_ARG -1
 
-		digits++;
-		decimal_places += decimal_inc;
-		accum *= 10;
-		accum += (*text) - '0';
+/**
+ * Get the format character for a positional argument, given the character
+ * following the `?`. Set `length` to the number of characters the format
+ * occupies after the `?`.
+ **/
+static char
+ason_get_arg_format(char c, size_t *length)
+{
+	if (c && strchr("iuIUfFs", c)) {
+		*length = 1;
+		return c;
 	}
 
-	if (decimal_inc && !decimal_places)
-		return text_start;
-
-	accum *= negator;
-
-	/* Technically << can be undefined for negative numbers in C */
-	accum = TO_FP(accum);
+	*length = 0;
+	return '?';
+}
 
-	while (decimal_places--)
-		accum /= 10;
+/**
+ * Convert a double to fixed point, rounding to nearest with ties to even as
+ * fixnum_parse() does for numbers in the text. Scaling by FP_BITS is exact, so
+ * only the final rounding loses anything. `f` must be in range.
+ **/
+static int64_t
+double_to_fixnum(double f)
+{
+	double scaled = f * FP_BITS;
+	int64_t ret = scaled;
+	double frac = scaled - ret;
 
-	if (text == text_start)
-		return text_start;
+	if (frac > 0.5 || (frac == 0.5 && (ret & 1)))
+		ret++;
+	else if (frac < -0.5 || (frac == -0.5 && (ret & 1)))
+		ret--;
 
-	*type = ASON_LEX_NUMBER;
-	data->n = accum;
-	return text;
+	return ret;
 }
 
 /**
- * Get a token from a positional argument.
+ * Get a token from a positional argument, taking the argument from `ap`.
+ * String arguments are not copied. Return 0 if the argument is a number too
+ * large to represent.
  **/
-static size_t
-ason_get_token_arg(char type, token_t *data, int *ttype, va_list ap)
+static int
+ason_get_token_arg(char type, token_t *data, int *ttype, va_list *ap)
 {
-	size_t ret = 1;
+	int64_t i;
+	uint64_t u;
+	double f;
 
 	*ttype = ASON_LEX_PREBAKED;
 
 	switch (type) {
 	case 'i':
-		data->value = ason_create_fixnum(0);
-		//data->value->n = TO_FP(va_arg(ap, int));
+		data->value = ason_create_fixnum(TO_FP(va_arg(*ap, int)));
 		break;
 	case 'u':
-		data->value = ason_create_fixnum(0);
-		//data->value->n = TO_FP(va_arg(ap, unsigned int));
+		data->value = ason_create_fixnum(TO_FP(va_arg(*ap,
+							    unsigned int)));
 		break;
 	case 'I':
-		data->value = ason_create_fixnum(0);
-		//data->value->n = TO_FP(va_arg(ap, int64_t));
+		i = va_arg(*ap, int64_t);
+
+		if (i > FP_WHOLE_MAX || i < FP_WHOLE_MIN)
+			return 0;
+
+		data->value = ason_create_fixnum(TO_FP(i));
 		break;
 	case 'U':
-		data->value = ason_create_fixnum(0);
-		//data->value->n = TO_FP(va_arg(ap, uint64_t));
+		u = va_arg(*ap, uint64_t);
+
+		if (u > FP_WHOLE_MAX)
+			return 0;
+
+		data->value = ason_create_fixnum(TO_FP(u));
 		break;
 
 	/* Float becomes double in va_arg, so we can handle these together */
 	case 'f':
 	case 'F':
-		data->value = ason_create_fixnum(0);
-		/* TO_FP was designed for integers, but this seems to work */
-		//data->value->n = TO_FP(va_arg(ap, double));
+		f = va_arg(*ap, double);
+
+		/* Also catches NaN */
+		if (! (f >= FP_WHOLE_MIN && f < FP_WHOLE_MAX + 1.0))
+			return 0;
+
+		data->value = ason_create_fixnum(double_to_fixnum(f));
 		break;
 	case 's':
-		data->c = xstrdup(va_arg(ap, char *));
+		data->c = va_arg(*ap, char *);
 		*ttype = ASON_LEX_STRING;
 		break;
 	default:
-		ret = 0;
-		data->value = ason_copy(va_arg(ap, ason_t *));
+		data->value = ason_copy(va_arg(*ap, ason_t *));
 	};
 
-	return ret;
+	return 1;
 }
 
 /**
- * Tokenize a string for ASON parsing.
+ * Tokenize a string for ASON parsing. Symbols are only recognized if
+ * `symtab` is given. Their names are interned, and `symtab` keeps them alive
+ * for as long as the tokens are in use.
  **/
 static size_t
 ason_get_token(const char *text, size_t length, int *type, token_t *data,
-	       ason_ns_t *ns, va_list ap)
+	       struct symtab *symtab, const struct scan_index *idx)
 {
 	const char *text_start = text;
 	const char *tok_start;
-	char *tmp;
-	int inc;
+	size_t inc;
 
-	while (length && isspace(*text)) {
-		length--;
-		text++;
-	}
+	text = scan_skip_space(idx, text);
+	length -= text - text_start;
 
 	if (! length)
 		return 0;
@@ -368,12 +433,12 @@ ason_get_token(const char *text, size_t length, int *type, token_t *data,
 	if (*text == '?') {
 		text++;
 		length--;
+		*type = ASON_LEX_ARG;
+		data->n = '?';
+
 		if (length) {
-			inc = ason_get_token_arg(*text, data, type, ap);
+			data->n = ason_get_arg_format(*text, &inc);
 			text += inc;
-			length -= inc;
-		} else {
-			ason_get_token_arg('\0', data, type, ap);
 		}
 
 		return text - text_start;
@@ -389,7 +454,7 @@ ason_get_token(const char *text, size_t length, int *type, token_t *data,
 		if (isdigit(*text))
 			return 0;
 
-		if (! ns)
+		if (! symtab)
 			return 0;
 
 		tok_start = text;
@@ -403,76 +468,570 @@ ason_get_token(const char *text, size_t length, int *type, token_t *data,
 		if (text == tok_start)
 			return 0;
 
-		data->c = xstrndup(tok_start, text - tok_start);
+		data->sym = intern(tok_start, text - tok_start);
+		symtab_get(symtab, data->sym);
+		intern_release(data->sym);
 		*type = ASON_LEX_SYMBOL;
 		return text - text_start;
 	}
 
 	tok_start = ++text;
+	text = scan_next_quote(idx, text);
 
-	while (length && (*text != '"' || *(text - 1) == '\\')) {
-		length--;
-		text++;
-	}
+	if (text == idx->text + idx->length)
+		return 0;
+
+	if (memchr(tok_start, '\\', text - tok_start))
+		data->c = string_unescape(tok_start, text - tok_start);
+	else
+		data->c = xstrndup(tok_start, text - tok_start);
 
-	if (*text != '"' || *(text - 1) == '\\')
+	if (! data->c)
 		return 0;
 
-	tmp = xstrndup(tok_start, text - tok_start);
-	data->c = string_unescape(tmp);
-	free(tmp);
 	text++;
 	*type = ASON_LEX_STRING;
 	return text - text_start;
 }
 
 /**
- * Read an ASON value from a string. Stop after `length` bytes. Use `ns` to
- * resolve and assign symbols, and `ap` to resolve tokens.
+ * Finish parsing and collect the result, and free the symbols loaded during
+ * the parse. Return NULL if the parse failed.
  **/
 static ason_t *
-ason_ns_vreadn(const char *text, size_t length, ason_ns_t *ns, va_list ap)
+ason_parse_finish(void *parser, struct parse_data *pdata)
+{
+	token_t data = { .n = 0 };
+
+	asonLemon(parser, 0, data, pdata);
+	asonLemonFree(parser, free);
+
+	if (pdata->symbols)
+		symtab_destroy(pdata->symbols);
+
+	if (! pdata->failed)
+		return pdata->ret;
+
+	if (pdata->ret)
+		ason_destroy(pdata->ret);
+
+	return NULL;
+}
+
+/**
+ * Parse UTF-8 ASON text. Stop after `length` bytes. Use `ns` to resolve and
+ * assign symbols, and `ap` to resolve tokens. If `ap` is NULL, positional
+ * arguments are an error. If `element` is set, only accept what could appear
+ * as an element of a list.
+ **/
+static ason_t *
+ason_parse_utf8(const char *text, size_t length, ason_ns_t *ns, va_list *ap,
+		int element)
 {
 	token_t data;
 	size_t len;
 	int type;
 	void *parser = asonLemonAlloc(xmalloc);
-	struct parse_data pdata = { .ret = NULL, .ns = ns, .failed = 0 };
-	char *tmp = xstrndup(text, length);
-	char *text_unicode = string_to_utf8(tmp);
+	struct symtab *symtab = ns ? symtab_create() : NULL;
+	struct parse_data pdata = { .ret = NULL, .ns = ns, .failed = 0,
+				    .symbols = symtab };
+	struct scan_index idx;
+	ason_t *ret;
 
-	free(tmp);
-	text = text_unicode;
+	scan_index_build(&idx, text, length);
+
+	if (element)
+		asonLemon(parser, ASON_LEX_ELEMENT, data, &pdata);
+
+	while ((len = ason_get_token(text, length, &type, &data, symtab,
+				     &idx))) {
+		if (type == ASON_LEX_ARG && ! ap)
+			break;
 
-	while ((len = ason_get_token(text, length, &type, &data, ns, ap))) {
 		text += len;
 		length -= len;
 
-		asonLemon(parser, type, data, &pdata);
-	}
+		if (type == ASON_LEX_ARG) {
+			if (! ason_get_token_arg(data.n, &data, &type, ap)) {
+				pdata.failed = 1;
+				break;
+			}
 
-	while (isspace(*text)) {
-		text++;
-		length--;
+			if (type == ASON_LEX_STRING)
+				data.c = xstrdup(data.c);
+		}
+
+		asonLemon(parser, type, data, &pdata);
 	}
 
-	if (length)
+	if (scan_skip_space(&idx, text) != idx.text + idx.length)
 		pdata.failed = 1;
 
-	asonLemon(parser, 0, data, &pdata);
-	asonLemonFree(parser, free);
+	ret = ason_parse_finish(parser, &pdata);
+	scan_index_free(&idx);
+
+	return ret;
+}
+
+/**
+ * Read an ASON value from a string. Stop after `length` bytes. Use `ns` to
+ * resolve and assign symbols, and `ap` to resolve tokens.
+ **/
+static ason_t *
+ason_ns_vreadn(const char *text, size_t length, ason_ns_t *ns, va_list ap)
+{
+	char *text_unicode = NULL;
+	va_list args;
+	ason_t *ret;
+
+	if (! string_input_is_utf8()) {
+		text_unicode = string_to_utf8_n(text, &length);
+		text = text_unicode;
+	}
+
+	va_copy(args, ap);
+	ret = ason_parse_utf8(text, length, ns, &args, 0);
+	va_end(args);
 
 	free(text_unicode);
 
-	if (! pdata.failed)
-		return pdata.ret;
+	return ret;
+}
+
+/**
+ * Smallest input worth splitting between threads.
+ **/
+#define PARALLEL_MIN_LENGTH 65536
+
+/**
+ * A run of top-level list elements for one thread to parse. Element `i`
+ * starts at `bounds[i]` and ends just before the delimiter at
+ * `bounds[i + 1] - 1`.
+ **/
+struct parallel_job {
+	const char *text;
+	const size_t *bounds;
+	ason_t **items;
+	size_t first;
+	size_t count;
+	int failed;
+	int threaded;
+	pthread_t thread;
+};
 
-	if (pdata.ret)
-		ason_destroy(pdata.ret);
+/**
+ * Find the elements of a list which makes up the whole of an indexed text.
+ * Fill `bounds` with the offset just past the opening bracket and each
+ * delimiter after it, and return the number of elements. Return 0 if the text
+ * is anything other than a single list, or holds positional arguments. Only
+ * the structural characters the index has already found are looked at.
+ **/
+static size_t
+parallel_split(const struct scan_index *idx, size_t **bounds)
+{
+	const char *text = idx->text;
+	const char *end = text + idx->length;
+	const char *pos = scan_skip_space(idx, text);
+	size_t depth = 0;
+	size_t count = 0;
+	size_t size = 0;
+
+	*bounds = NULL;
+
+	if (pos == end || *pos != '[')
+		return 0;
+
+	for (; (pos = scan_next_structural(idx, pos)) < end; pos++) {
+		switch (*pos) {
+		case '[':
+		case '{':
+		case '(':
+			if (depth++)
+				continue;
+			break;
+		case ']':
+		case '}':
+		case ')':
+			if (! depth || --depth)
+				continue;
+			break;
+		case ',':
+			if (depth != 1)
+				continue;
+			break;
+		default:
+			goto fail;
+		}
+
+		if (count == size) {
+			size = size ? size * 2 : 1024;
+			*bounds = xrealloc(*bounds, size * sizeof(size_t));
+		}
+
+		(*bounds)[count++] = pos + 1 - text;
+
+		if (! depth)
+			break;
+	}
+
+	if (depth || pos == end || scan_skip_space(idx, pos + 1) != end)
+		goto fail;
+
+	return count - 1;
+
+fail:
+	free(*bounds);
+	*bounds = NULL;
+	return 0;
+}
+
+/**
+ * Parse a run of top-level list elements.
+ **/
+static void *
+parallel_parse(void *data)
+{
+	struct parallel_job *job = data;
+	const size_t *bounds = job->bounds;
+	size_t i;
+
+	for (i = job->first; i < job->first + job->count; i++) {
+		job->items[i] = ason_parse_utf8(job->text + bounds[i],
+						bounds[i + 1] - 1 - bounds[i],
+						NULL, NULL, 1);
+
+		if (! job->items[i]) {
+			job->failed = 1;
+			break;
+		}
+	}
 
 	return NULL;
 }
 
+/**
+ * Parse a list of `count` elements found by parallel_split(), dividing the
+ * elements between `threads` threads by length.
+ **/
+static ason_t *
+parallel_parse_list(const char *text, const size_t *bounds, size_t count,
+		    unsigned int threads)
+{
+	struct parallel_job *jobs = xcalloc(threads, sizeof(struct parallel_job));
+	ason_t **items = xcalloc(count, sizeof(ason_t *));
+	size_t share = (bounds[count] - bounds[0]) / threads;
+	size_t next = 0;
+	ason_t *ret = NULL;
+	int failed = 0;
+	unsigned int i;
+	size_t j;
+
+	for (i = 0; i < threads; i++) {
+		jobs[i].text = text;
+		jobs[i].bounds = bounds;
+		jobs[i].items = items;
+		jobs[i].first = next;
+
+		while (next < count && (i == threads - 1 ||
+					bounds[next] - bounds[jobs[i].first] <
+					share))
+			next++;
+
+		jobs[i].count = next - jobs[i].first;
+	}
+
+	for (i = 1; i < threads; i++)
+		jobs[i].threaded = ! pthread_create(&jobs[i].thread, NULL,
+						    parallel_parse, &jobs[i]);
+
+	for (i = 0; i < threads; i++)
+		if (! jobs[i].threaded)
+			parallel_parse(&jobs[i]);
+
+	for (i = 0; i < threads; i++) {
+		if (jobs[i].threaded)
+			pthread_join(jobs[i].thread, NULL);
+
+		failed |= jobs[i].failed;
+	}
+
+	if (! failed)
+		ret = ason_create_list_n(items, count);
+
+	for (j = 0; j < count; j++)
+		if (items[j])
+			ason_destroy(items[j]);
+
+	free(items);
+	free(jobs);
+
+	return ret;
+}
+
+/**
+ * Read an ASON list, parsing its elements on several threads. Stop after
+ * `length` bytes. If `threads` is 0, use one thread per online CPU.
+ **/
+static ason_t *
+ason_readn_parallel_utf8(const char *text, size_t length,
+			 unsigned int threads)
+{
+	struct scan_index idx;
+	size_t *bounds;
+	size_t count;
+	ason_t *ret;
+
+	if (! threads) {
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+		threads = online > 0 ? online : 1;
+	}
+
+	if (threads < 2 || length < PARALLEL_MIN_LENGTH)
+		return ason_parse_utf8(text, length, NULL, NULL, 0);
+
+	scan_index_build(&idx, text, length);
+	count = parallel_split(&idx, &bounds);
+
+	if (! count) {
+		scan_index_free(&idx);
+		return ason_parse_utf8(text, length, NULL, NULL, 0);
+	}
+
+	if (count == 1 && scan_skip_space(&idx, text + bounds[0]) ==
+	    text + bounds[1] - 1)
+		ret = ason_create_list(NULL);
+	else
+		ret = parallel_parse_list(text, bounds, count,
+					  threads < count ? threads : count);
+
+	scan_index_free(&idx);
+	free(bounds);
+
+	return ret;
+}
+
+/**
+ * A token in a compiled template. `arg` is the format character for tokens
+ * which stand in for a positional argument, and is 0 otherwise.
+ **/
+struct tpl_token {
+	int type;
+	token_t data;
+	char arg;
+};
+
+/**
+ * A compiled template. The text has been tokenized and its syntax checked
+ * once, so executing the template only has to fill in positional arguments
+ * and run the grammar. String literals are lent to the grammar rather than
+ * copied each time, and `symtab` keeps the symbol names interned.
+ **/
+struct ason_tpl {
+	ason_ns_t *ns;
+	struct symtab *symtab;
+	struct tpl_token *tokens;
+	size_t count;
+};
+
+/**
+ * Run a compiled template through the grammar. Use `ap` to fill in positional
+ * arguments. If `ap` is NULL, only check the template's syntax, using an empty
+ * placeholder for each argument.
+ **/
+static ason_t *
+ason_tpl_run(ason_tpl_t *tpl, va_list *ap)
+{
+	void *parser = asonLemonAlloc(xmalloc);
+	struct parse_data pdata = { .ret = NULL, .ns = tpl->ns, .failed = 0,
+				    .borrowed = 1, .check = ! ap };
+	struct tpl_token *tok;
+	token_t data;
+	int type;
+	size_t i;
+
+	for (i = 0; i < tpl->count; i++) {
+		tok = &tpl->tokens[i];
+		type = tok->type;
+		data = tok->data;
+
+		if (tok->arg && ! ap) {
+			type = tok->arg == 's' ? ASON_LEX_STRING :
+				ASON_LEX_PREBAKED;
+
+			if (type == ASON_LEX_STRING)
+				data.c = (char *)"";
+			else
+				data.value = ASON_EMPTY;
+		} else if (tok->arg &&
+			   ! ason_get_token_arg(tok->arg, &data, &type, ap)) {
+			pdata.failed = 1;
+			break;
+		}
+
+		asonLemon(parser, type, data, &pdata);
+	}
+
+	return ason_parse_finish(parser, &pdata);
+}
+
+/**
+ * Compile a template from a string. Stop after `length` bytes. Use `ns` to
+ * resolve and assign symbols when the template is executed. Return NULL if
+ * the template is not valid ASON.
+ **/
+static ason_tpl_t *
+ason_ns_preparen(ason_ns_t *ns, const char *text, size_t length)
+{
+	ason_tpl_t *tpl = xcalloc(1, sizeof(ason_tpl_t));
+	struct tpl_token *tok;
+	struct scan_index idx;
+	char *text_unicode = NULL;
+	size_t size = 0;
+	size_t len;
+	int type;
+	token_t data;
+	ason_t *checked = NULL;
+
+	if (! string_input_is_utf8()) {
+		text_unicode = string_to_utf8_n(text, &length);
+		text = text_unicode;
+	}
+
+	tpl->ns = ns;
+	tpl->symtab = ns ? symtab_create() : NULL;
+	scan_index_build(&idx, text, length);
+
+	while ((len = ason_get_token(text, length, &type, &data, tpl->symtab,
+				     &idx))) {
+		text += len;
+		length -= len;
+
+		if (tpl->count == size) {
+			size = size ? size * 2 : 16;
+			tpl->tokens = xrealloc(tpl->tokens,
+					       size * sizeof(struct tpl_token));
+		}
+
+		tok = &tpl->tokens[tpl->count++];
+		tok->type = type;
+		tok->data = data;
+		tok->arg = type == ASON_LEX_ARG ? data.n : 0;
+	}
+
+	if (scan_skip_space(&idx, text) == idx.text + idx.length)
+		checked = ason_tpl_run(tpl, NULL);
+
+	if (checked) {
+		ason_destroy(checked);
+	} else {
+		ason_tpl_destroy(tpl);
+		tpl = NULL;
+	}
+
+	scan_index_free(&idx);
+	free(text_unicode);
+
+	return tpl;
+}
+
+/**
+ * Read an ASON value from a file. Use `ns` to resolve and assign symbols, and
+ * `ap` to resolve tokens. The file is mapped and parsed in place, so its
+ * contents are never copied.
+ **/
+static ason_t *
+ason_ns_vread_file(const char *path, ason_ns_t *ns, va_list ap)
+{
+	struct stat st;
+	ason_t *ret;
+	void *map;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	if (! S_ISREG(st.st_mode)) {
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (! st.st_size) {
+		close(fd);
+		return ason_ns_vreadn("", 0, ns, ap);
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return NULL;
+
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+	ret = ason_ns_vreadn(map, st.st_size, ns, ap);
+	munmap(map, st.st_size);
+
+	return ret;
+}
+
+/**
+ * Compile an ASON template. Use `ns` to resolve and assign symbols.
+ **/
+API_EXPORT ason_tpl_t *
+ason_ns_prepare(ason_ns_t *ns, const char *text)
+{
+	return ason_ns_preparen(ns, text, strlen(text));
+}
+
+/**
+ * Compile an ASON template.
+ **/
+API_EXPORT ason_tpl_t *
+ason_prepare(const char *text)
+{
+	return ason_ns_preparen(NULL, text, strlen(text));
+}
+
+/**
+ * Create an ASON value from a compiled template and positional arguments.
+ **/
+API_EXPORT ason_t *
+ason_bind_exec(ason_tpl_t *tpl, ...)
+{
+	va_list ap;
+	ason_t *ret;
+
+	va_start(ap, tpl);
+	ret = ason_tpl_run(tpl, &ap);
+	va_end(ap);
+	return ret;
+}
+
+/**
+ * Free a compiled template.
+ **/
+API_EXPORT void
+ason_tpl_destroy(ason_tpl_t *tpl)
+{
+	size_t i;
+
+	for (i = 0; i < tpl->count; i++)
+		if (tpl->tokens[i].type == ASON_LEX_STRING)
+			free(tpl->tokens[i].data.c);
+
+	if (tpl->symtab)
+		symtab_destroy(tpl->symtab);
+
+	free(tpl->tokens);
+	free(tpl);
+}
+
 /**
  * Read an ASON value from a string. Stop after `length` bytes. Use `ns` to
  * resolve and assign symbols.
@@ -504,6 +1063,21 @@ ason_ns_read(ason_ns_t *ns, const char *text, ...)
 	return ret;
 }
 
+/**
+ * Read an ASON value from a file. Use `ns` to resolve and assign symbols.
+ **/
+API_EXPORT ason_t *
+ason_ns_read_file(ason_ns_t *ns, const char *path, ...)
+{
+	va_list ap;
+	ason_t *ret;
+
+	va_start(ap, path);
+	ret = ason_ns_vread_file(path, ns, ap);
+	va_end(ap);
+	return ret;
+}
+
 /**
  * Read an ASON value from a string.
  **/
@@ -534,4 +1108,40 @@ ason_readn(const char *text, size_t length, ...)
 	return ret;
 }
 
+/**
+ * Read an ASON list, parsing its elements on several threads. Stop after
+ * `length` bytes.
+ **/
+API_EXPORT ason_t *
+ason_readn_parallel(const char *text, size_t length, unsigned int threads)
+{
+	char *text_unicode = NULL;
+	ason_t *ret;
+
+	if (! string_input_is_utf8()) {
+		text_unicode = string_to_utf8_n(text, &length);
+		text = text_unicode;
+	}
+
+	ret = ason_readn_parallel_utf8(text, length, threads);
+	free(text_unicode);
+
+	return ret;
+}
+
+/**
+ * Read an ASON value from a file.
+ **/
+API_EXPORT ason_t *
+ason_read_file(const char *path, ...)
+{
+	va_list ap;
+	ason_t *ret;
+
+	va_start(ap, path);
+	ret = ason_ns_vread_file(path, NULL, ap);
+	va_end(ap);
+	return ret;
+}
+
 }
@@ -0,0 +1,368 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "scan.h"
+#include "util.h"
+
+/**
+ * Raw per-character bits for one block, before escapes are resolved.
+ **/
+struct scan_raw {
+	uint64_t space;
+	uint64_t quote;
+	uint64_t backslash;
+	uint64_t structural;
+};
+
+#if defined(__AVX2__)
+
+/**
+ * Classify 32 bytes of input. Whitespace is ' ' or '\t' through '\r'.
+ * Setting bit 5 folds '[' and ']' onto '{' and '}', and clearing bit 0 folds
+ * ')' onto '('.
+ **/
+static inline void
+scan_classify_32(const char *in, uint32_t *space, uint32_t *quote,
+		 uint32_t *backslash, uint32_t *structural)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i *)in);
+	__m256i ctl = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+	__m256i ws = _mm256_cmpeq_epi8(_mm256_min_epu8(ctl,
+						       _mm256_set1_epi8(4)),
+				       ctl);
+	__m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+	__m256i even = _mm256_and_si256(v, _mm256_set1_epi8(~1));
+	__m256i st;
+
+	ws = _mm256_or_si256(ws, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+
+	st = _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{'));
+	st = _mm256_or_si256(st, _mm256_cmpeq_epi8(lower,
+						   _mm256_set1_epi8('}')));
+	st = _mm256_or_si256(st, _mm256_cmpeq_epi8(even,
+						   _mm256_set1_epi8('(')));
+	st = _mm256_or_si256(st, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')));
+	st = _mm256_or_si256(st, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('?')));
+
+	*space = _mm256_movemask_epi8(ws);
+	*quote = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v,
+						_mm256_set1_epi8('"')));
+	*backslash = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v,
+						_mm256_set1_epi8('\\')));
+	*structural = _mm256_movemask_epi8(st);
+}
+
+/**
+ * Classify every byte of a 64-byte block.
+ **/
+static inline void
+scan_classify(const char *in, struct scan_raw *raw)
+{
+	uint32_t s[2], q[2], b[2], t[2];
+
+	scan_classify_32(in, &s[0], &q[0], &b[0], &t[0]);
+	scan_classify_32(in + 32, &s[1], &q[1], &b[1], &t[1]);
+
+	raw->space = s[0] | (uint64_t)s[1] << 32;
+	raw->quote = q[0] | (uint64_t)q[1] << 32;
+	raw->backslash = b[0] | (uint64_t)b[1] << 32;
+	raw->structural = t[0] | (uint64_t)t[1] << 32;
+}
+
+#elif defined(__SSE2__)
+
+/**
+ * Classify 16 bytes of input. Whitespace is ' ' or '\t' through '\r'.
+ * Setting bit 5 folds '[' and ']' onto '{' and '}', and clearing bit 0 folds
+ * ')' onto '('.
+ **/
+static inline void
+scan_classify_16(const char *in, uint64_t *space, uint64_t *quote,
+		 uint64_t *backslash, uint64_t *structural)
+{
+	__m128i v = _mm_loadu_si128((const __m128i *)in);
+	__m128i ctl = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+	__m128i ws = _mm_cmpeq_epi8(_mm_min_epu8(ctl, _mm_set1_epi8(4)), ctl);
+	__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+	__m128i even = _mm_and_si128(v, _mm_set1_epi8(~1));
+	__m128i st;
+
+	ws = _mm_or_si128(ws, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+
+	st = _mm_cmpeq_epi8(lower, _mm_set1_epi8('{'));
+	st = _mm_or_si128(st, _mm_cmpeq_epi8(lower, _mm_set1_epi8('}')));
+	st = _mm_or_si128(st, _mm_cmpeq_epi8(even, _mm_set1_epi8('(')));
+	st = _mm_or_si128(st, _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+	st = _mm_or_si128(st, _mm_cmpeq_epi8(v, _mm_set1_epi8('?')));
+	*structural = (uint16_t)_mm_movemask_epi8(st);
+
+	*space = (uint16_t)_mm_movemask_epi8(ws);
+	*quote = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v,
+						_mm_set1_epi8('"')));
+	*backslash = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v,
+						_mm_set1_epi8('\\')));
+}
+
+/**
+ * Classify every byte of a 64-byte block.
+ **/
+static inline void
+scan_classify(const char *in, struct scan_raw *raw)
+{
+	uint64_t s, q, b, t;
+	int i;
+
+	raw->space = raw->quote = raw->backslash = raw->structural = 0;
+
+	for (i = 0; i < 4; i++) {
+		scan_classify_16(in + 16 * i, &s, &q, &b, &t);
+		raw->space |= s << (16 * i);
+		raw->quote |= q << (16 * i);
+		raw->backslash |= b << (16 * i);
+		raw->structural |= t << (16 * i);
+	}
+}
+
+#else
+
+/**
+ * Classify every byte of a 64-byte block.
+ **/
+static inline void
+scan_classify(const char *in, struct scan_raw *raw)
+{
+	uint64_t bit;
+	int i;
+
+	raw->space = raw->quote = raw->backslash = raw->structural = 0;
+
+	for (i = 0; i < 64; i++) {
+		bit = (uint64_t)1 << i;
+
+		if (in[i] == ' ' || (in[i] >= '\t' && in[i] <= '\r'))
+			raw->space |= bit;
+		else if (in[i] == '"')
+			raw->quote |= bit;
+		else if (in[i] == '\\')
+			raw->backslash |= bit;
+		else if (in[i] && strchr("[]{}(),?", in[i]))
+			raw->structural |= bit;
+	}
+}
+
+#endif
+
+#define EVEN_BITS 0x5555555555555555ULL
+#define ODD_BITS (~EVEN_BITS)
+
+/**
+ * Find the characters which are escaped by a backslash, that is, those which
+ * follow a run of backslashes of odd length. `carry` is set when this block
+ * ends in such a run, and is taken into account when starting the next.
+ **/
+static uint64_t
+scan_escaped(uint64_t backslash, uint64_t *carry)
+{
+	uint64_t starts = backslash & ~(backslash << 1);
+	uint64_t even_start_mask = EVEN_BITS ^ *carry;
+	uint64_t even_starts = starts & even_start_mask;
+	uint64_t odd_starts = starts & ~even_start_mask;
+	uint64_t even_carries = backslash + even_starts;
+	uint64_t odd_carries = backslash + odd_starts;
+	uint64_t next_carry = odd_carries < backslash;
+
+	odd_carries |= *carry;
+	*carry = next_carry;
+
+	even_carries &= ~backslash;
+	odd_carries &= ~backslash;
+
+	return (even_carries & ODD_BITS) | (odd_carries & EVEN_BITS);
+}
+
+/**
+ * Find the characters inside string literals, given the unescaped quotes of a
+ * block. A prefix XOR over the quote bits sets every bit from an opening quote
+ * up to its closing quote. `carry` is all ones when the previous block ended
+ * inside a string, and is updated for the next block.
+ **/
+static uint64_t
+scan_in_string(uint64_t quote, uint64_t *carry)
+{
+	uint64_t mask = quote;
+
+	mask ^= mask << 1;
+	mask ^= mask << 2;
+	mask ^= mask << 4;
+	mask ^= mask << 8;
+	mask ^= mask << 16;
+	mask ^= mask << 32;
+	mask ^= *carry;
+
+	*carry = (uint64_t)((int64_t)mask >> 63);
+
+	return mask;
+}
+
+/**
+ * Build a structural index for a run of text.
+ **/
+void
+scan_index_build(struct scan_index *idx, const char *text, size_t length)
+{
+	struct scan_raw raw;
+	uint64_t carry = 0;
+	uint64_t string_carry = 0;
+	uint64_t escaped;
+	uint64_t quote;
+	char tail[64];
+	size_t full = length / 64;
+	size_t i;
+
+	idx->text = text;
+	idx->length = length;
+	idx->count = (length + 63) / 64;
+	idx->blocks = xmalloc((idx->count ? idx->count : 1) *
+			      sizeof(struct scan_block));
+
+	for (i = 0; i < idx->count; i++) {
+		if (i < full) {
+			scan_classify(text + 64 * i, &raw);
+		} else {
+			/* Zero padding is neither space, quote, escape nor
+			 * structural */
+			memset(tail, 0, sizeof(tail));
+			memcpy(tail, text + 64 * i, length % 64);
+			scan_classify(tail, &raw);
+		}
+
+		/* Quotes after an odd run of backslashes are escaped */
+		escaped = scan_escaped(raw.backslash, &carry);
+
+		quote = raw.quote & ~escaped;
+
+		idx->blocks[i].space = raw.space;
+		idx->blocks[i].quote = quote;
+		idx->blocks[i].structural = raw.structural &
+			~scan_in_string(quote, &string_carry);
+	}
+}
+
+/**
+ * Free the memory held by a structural index.
+ **/
+void
+scan_index_free(struct scan_index *idx)
+{
+	free(idx->blocks);
+	idx->blocks = NULL;
+	idx->count = 0;
+}
+
+/**
+ * Places scan_find() can stop at.
+ **/
+enum scan_stop {
+	SCAN_NONSPACE,
+	SCAN_QUOTE,
+	SCAN_STRUCTURAL,
+};
+
+/**
+ * Get the bits of a block which mark a place to stop.
+ **/
+static inline uint64_t
+scan_stops(const struct scan_index *idx, size_t block, enum scan_stop stop)
+{
+	if (stop == SCAN_QUOTE)
+		return idx->blocks[block].quote;
+
+	if (stop == SCAN_STRUCTURAL)
+		return idx->blocks[block].structural;
+
+	return ~idx->blocks[block].space;
+}
+
+/**
+ * Find the first stop at or after `pos`. Return the end of the text if there
+ * is none.
+ **/
+static const char *
+scan_find(const struct scan_index *idx, const char *pos, enum scan_stop stop)
+{
+	size_t off = pos - idx->text;
+	size_t block = off / 64;
+	uint64_t bits;
+
+	if (off >= idx->length)
+		return idx->text + idx->length;
+
+	bits = scan_stops(idx, block, stop) & (~(uint64_t)0 << (off % 64));
+
+	while (! bits) {
+		if (++block == idx->count)
+			return idx->text + idx->length;
+
+		bits = scan_stops(idx, block, stop);
+	}
+
+	off = block * 64 + __builtin_ctzll(bits);
+
+	if (off > idx->length)
+		off = idx->length;
+
+	return idx->text + off;
+}
+
+/**
+ * Skip any whitespace at `pos`.
+ **/
+const char *
+scan_skip_space(const struct scan_index *idx, const char *pos)
+{
+	return scan_find(idx, pos, SCAN_NONSPACE);
+}
+
+/**
+ * Find the next unescaped quote at or after `pos`.
+ **/
+const char *
+scan_next_quote(const struct scan_index *idx, const char *pos)
+{
+	return scan_find(idx, pos, SCAN_QUOTE);
+}
+
+/**
+ * Find the next bracket, brace, parenthesis, comma or question mark at or
+ * after `pos` which is not inside a string literal.
+ **/
+const char *
+scan_next_structural(const struct scan_index *idx, const char *pos)
+{
+	return scan_find(idx, pos, SCAN_STRUCTURAL);
+}
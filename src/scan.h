@@ -0,0 +1,65 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Structural bits for one 64-byte block of input. Bit n of each field
+ * describes byte n of the block. `structural` marks brackets, braces,
+ * parentheses, commas and question marks outside of string literals.
+ **/
+struct scan_block {
+	uint64_t space;
+	uint64_t quote;
+	uint64_t structural;
+};
+
+/**
+ * A structural index over a run of ASON text, built in a single pass before
+ * tokenizing. The tokenizer uses it to jump over whitespace and to the end of
+ * string literals without examining each byte.
+ **/
+struct scan_index {
+	const char *text;
+	size_t length;
+	struct scan_block *blocks;
+	size_t count;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void scan_index_build(struct scan_index *idx, const char *text,
+		      size_t length);
+void scan_index_free(struct scan_index *idx);
+const char *scan_skip_space(const struct scan_index *idx, const char *pos);
+const char *scan_next_quote(const struct scan_index *idx, const char *pos);
+const char *scan_next_structural(const struct scan_index *idx,
+				 const char *pos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCAN_H */
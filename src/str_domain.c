@@ -0,0 +1,563 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "str_domain.h"
+#include "util.h"
+
+/**
+ * A string domain containing all strings.
+ **/
+ason_str_dom_t ASON_STR_DOM_UNIVERSE_DATA = {
+	.items = NULL,
+	.count = 0,
+	.inverted = 1,
+	.refcount = 0,
+};
+ason_str_dom_t * const ASON_STR_DOM_UNIVERSE = &ASON_STR_DOM_UNIVERSE_DATA;
+
+/**
+ * Which strings a merge of two domains keeps: those only in the first, those
+ * only in the second, and those in both.
+ **/
+#define KEEP_A 1
+#define KEEP_B 2
+#define KEEP_BOTH 4
+
+/**
+ * Domains with at least this many strings are searched with a trie rather
+ * than a binary search.
+ **/
+#define STR_TRIE_MIN 64
+
+/**
+ * When one side of an intersection has this many times fewer strings than the
+ * other, look its strings up in the other rather than merging the two.
+ **/
+#define STR_LOOKUP_RATIO 16
+
+/**
+ * Order a string against an interned string, bytewise with shorter strings
+ * first.
+ **/
+static int
+str_compare(const char *text, size_t length, struct interned *b)
+{
+	int ret = memcmp(text, b->text, length < b->length ? length : b->length);
+
+	if (ret)
+		return ret;
+
+	if (length == b->length)
+		return 0;
+
+	return length < b->length ? -1 : 1;
+}
+
+/**
+ * Order two interned strings. Equal strings are always the same pointer.
+ **/
+static int
+str_compare_interned(struct interned *a, struct interned *b)
+{
+	if (a == b)
+		return 0;
+
+	return str_compare(a->text, a->length, b);
+}
+
+/**
+ * A run of a domain's strings waiting to be added to a trie under `node`. All
+ * the strings share their first `depth` bytes.
+ **/
+struct str_trie_job {
+	size_t lo;
+	size_t hi;
+	size_t depth;
+	uint32_t node;
+};
+
+/**
+ * Build a trie over the strings of a domain. The strings are sorted, so those
+ * sharing a prefix are always next to each other, and the common prefix of a
+ * run is the common prefix of its first and last string.
+ **/
+static struct str_trie *
+str_trie_build(ason_str_dom_t *dom)
+{
+	struct str_trie *trie = xmalloc(sizeof(struct str_trie));
+	struct str_trie_job *stack;
+	struct str_trie_job job;
+	struct str_trie_edge *edge;
+	struct str_trie_node *node;
+	struct interned **items = dom->items;
+	size_t nodes = 1;
+	size_t edges = 0;
+	size_t top = 0;
+	size_t i, j, end;
+
+	/* Each string adds at most one edge, and at most one more where it
+	 * splits off from its neighbours. */
+	trie->nodes = xcalloc(2 * dom->count + 1, sizeof(struct str_trie_node));
+	trie->edges = xcalloc(2 * dom->count, sizeof(struct str_trie_edge));
+	trie->labels = xmalloc(2 * dom->count);
+	stack = xmalloc((2 * dom->count + 1) * sizeof(struct str_trie_job));
+
+	stack[top++] = (struct str_trie_job){ 0, dom->count, 0, 0 };
+
+	while (top) {
+		job = stack[--top];
+		node = &trie->nodes[job.node];
+
+		if (items[job.lo]->length == job.depth) {
+			node->terminal = 1;
+			job.lo++;
+		}
+
+		node->first = edges;
+
+		for (i = job.lo; i < job.hi; i = j) {
+			for (j = i + 1; j < job.hi &&
+			     items[j]->text[job.depth] ==
+			     items[i]->text[job.depth]; j++);
+
+			for (end = job.depth + 1;
+			     end < items[i]->length &&
+			     end < items[j - 1]->length &&
+			     items[i]->text[end] == items[j - 1]->text[end];
+			     end++);
+
+			edge = &trie->edges[edges];
+			edge->text = items[i]->text + job.depth;
+			edge->length = end - job.depth;
+			edge->target = nodes;
+			trie->labels[edges++] = items[i]->text[job.depth];
+			node->count++;
+
+			stack[top++] = (struct str_trie_job){ i, j, end, nodes++ };
+		}
+	}
+
+	free(stack);
+	return trie;
+}
+
+/**
+ * Check whether a string is in a trie.
+ **/
+static int
+str_trie_contains(struct str_trie *trie, const char *text, size_t length)
+{
+	struct str_trie_node *node = trie->nodes;
+	struct str_trie_edge *edge;
+	unsigned char *label;
+
+	while (length) {
+		label = memchr(trie->labels + node->first, *text, node->count);
+
+		if (! label)
+			return 0;
+
+		edge = &trie->edges[label - trie->labels];
+
+		if (edge->length > length || memcmp(edge->text, text,
+						    edge->length))
+			return 0;
+
+		text += edge->length;
+		length -= edge->length;
+		node = &trie->nodes[edge->target];
+	}
+
+	return node->terminal;
+}
+
+/**
+ * Free a trie.
+ **/
+static void
+str_trie_destroy(struct str_trie *trie)
+{
+	if (! trie)
+		return;
+
+	free(trie->nodes);
+	free(trie->edges);
+	free(trie->labels);
+	free(trie);
+}
+
+/**
+ * Check whether a string is one of a domain's items, regardless of whether
+ * the domain is inverted. Domains may be shared between threads, so if two
+ * threads build a trie at once, one keeps its trie and the other frees it.
+ **/
+static int
+ason_str_dom_has(ason_str_dom_t *dom, const char *text, size_t length)
+{
+	struct str_trie *trie;
+	struct str_trie *expect = NULL;
+	size_t lo = 0;
+	size_t hi = dom->count;
+	size_t mid;
+	int cmp;
+
+	if (dom->count >= STR_TRIE_MIN) {
+		trie = __atomic_load_n(&dom->trie, __ATOMIC_ACQUIRE);
+
+		if (! trie) {
+			trie = str_trie_build(dom);
+
+			if (! __atomic_compare_exchange_n(&dom->trie, &expect,
+							  trie, 0,
+							  __ATOMIC_ACQ_REL,
+							  __ATOMIC_ACQUIRE)) {
+				str_trie_destroy(trie);
+				trie = expect;
+			}
+		}
+
+		return str_trie_contains(trie, text, length);
+	}
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		cmp = str_compare(text, length, dom->items[mid]);
+
+		if (! cmp)
+			return 1;
+
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Allocate a new string domain with room for `size` items.
+ **/
+static ason_str_dom_t *
+ason_str_dom_alloc(size_t size, int inverted)
+{
+	ason_str_dom_t *ret = xcalloc(1, sizeof(ason_str_dom_t));
+
+	ret->items = xcalloc(size, sizeof(struct interned *));
+	ret->inverted = inverted;
+	ret->refcount = 1;
+	return ret;
+}
+
+/**
+ * Merge the items of two domains in a single pass, keeping the strings
+ * selected by `keep`. Return the new domain, or NULL or the universe if no
+ * strings were kept.
+ **/
+static ason_str_dom_t *
+ason_str_dom_merge(ason_str_dom_t *a, ason_str_dom_t *b, int keep,
+		   int inverted)
+{
+	ason_str_dom_t *ret = ason_str_dom_alloc(a->count + b->count, inverted);
+	size_t i, j, k;
+	int cmp;
+
+	for (i = j = k = 0; i < a->count && j < b->count;) {
+		cmp = str_compare_interned(a->items[i], b->items[j]);
+
+		if (cmp < 0) {
+			if (keep & KEEP_A)
+				ret->items[k++] = intern_ref(a->items[i]);
+			i++;
+		} else if (cmp > 0) {
+			if (keep & KEEP_B)
+				ret->items[k++] = intern_ref(b->items[j]);
+			j++;
+		} else {
+			if (keep & KEEP_BOTH)
+				ret->items[k++] = intern_ref(a->items[i]);
+			i++;
+			j++;
+		}
+	}
+
+	if (keep & KEEP_A)
+		while (i < a->count)
+			ret->items[k++] = intern_ref(a->items[i++]);
+
+	if (keep & KEEP_B)
+		while (j < b->count)
+			ret->items[k++] = intern_ref(b->items[j++]);
+
+	ret->count = k;
+
+	if (k)
+		return ret;
+
+	ason_str_dom_destroy(ret);
+	return inverted ? ASON_STR_DOM_UNIVERSE : NULL;
+}
+
+/**
+ * Make a domain of the strings of `a` which are (if `want` is set) or are not
+ * items of `b`, by looking each of them up in `b`. Return NULL if there are
+ * none.
+ **/
+static ason_str_dom_t *
+ason_str_dom_filter(ason_str_dom_t *a, ason_str_dom_t *b, int want)
+{
+	ason_str_dom_t *ret = ason_str_dom_alloc(a->count, 0);
+	size_t i;
+
+	for (i = 0; i < a->count; i++)
+		if (ason_str_dom_has(b, a->items[i]->text,
+				     a->items[i]->length) == want)
+			ret->items[ret->count++] = intern_ref(a->items[i]);
+
+	if (ret->count)
+		return ret;
+
+	ason_str_dom_destroy(ret);
+	return NULL;
+}
+
+/**
+ * Invert the meaning of the set.
+ **/
+ason_str_dom_t *
+ason_str_dom_invert(ason_str_dom_t *dom)
+{
+	ason_str_dom_t *ret;
+	size_t i;
+
+	if (! dom)
+		return ASON_STR_DOM_UNIVERSE;
+
+	if (dom == ASON_STR_DOM_UNIVERSE)
+		return NULL;
+
+	ret = ason_str_dom_alloc(dom->count, ! dom->inverted);
+	ret->count = dom->count;
+
+	for (i = 0; i < dom->count; i++)
+		ret->items[i] = intern_ref(dom->items[i]);
+
+	return ret;
+}
+
+/**
+ * Union the set with another.
+ **/
+ason_str_dom_t *
+ason_str_dom_union(ason_str_dom_t *a, ason_str_dom_t *b)
+{
+	ason_str_dom_t *tmp;
+
+	if (a == b || ! b)
+		return ason_str_dom_copy(a);
+	if (! a)
+		return ason_str_dom_copy(b);
+
+	if (a == ASON_STR_DOM_UNIVERSE || b == ASON_STR_DOM_UNIVERSE)
+		return ASON_STR_DOM_UNIVERSE;
+
+	if (! a->inverted && ! b->inverted)
+		return ason_str_dom_merge(a, b, KEEP_A | KEEP_B | KEEP_BOTH, 0);
+
+	if (a->inverted && b->inverted)
+		return ason_str_dom_merge(a, b, KEEP_BOTH, 1);
+
+	if (a->inverted) {
+		tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	/* A finite set with a co-finite one. The result excludes whatever b
+	 * excludes and a doesn't contain. */
+	return ason_str_dom_merge(a, b, KEEP_B, 1);
+}
+
+/**
+ * Intersect two string domains.
+ **/
+ason_str_dom_t *
+ason_str_dom_intersect(ason_str_dom_t *a, ason_str_dom_t *b)
+{
+	ason_str_dom_t *tmp;
+
+	if (a == NULL || b == NULL)
+		return NULL;
+
+	if (a == ASON_STR_DOM_UNIVERSE || a == b)
+		return ason_str_dom_copy(b);
+	if (b == ASON_STR_DOM_UNIVERSE)
+		return ason_str_dom_copy(a);
+
+	if (a->inverted && b->inverted)
+		return ason_str_dom_merge(a, b, KEEP_A | KEEP_B | KEEP_BOTH, 1);
+
+	if (b->count == 1 && ! b->inverted) {
+		tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	/* Matching one string against a set is just a lookup. */
+	if (a->count == 1 && ! a->inverted) {
+		if (ason_str_dom_contains(b, a->items[0]->text,
+					  a->items[0]->length))
+			return ason_str_dom_copy(a);
+
+		return NULL;
+	}
+
+	if (! a->inverted && ! b->inverted) {
+		if (a->count > b->count) {
+			tmp = a;
+			a = b;
+			b = tmp;
+		}
+
+		if (a->count * STR_LOOKUP_RATIO < b->count)
+			return ason_str_dom_filter(a, b, 1);
+
+		return ason_str_dom_merge(a, b, KEEP_BOTH, 0);
+	}
+
+	if (a->inverted) {
+		tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	/* A finite set with a co-finite one. The result is whatever a contains
+	 * and b doesn't exclude. */
+	if (a->count * STR_LOOKUP_RATIO < b->count)
+		return ason_str_dom_filter(a, b, 0);
+
+	return ason_str_dom_merge(a, b, KEEP_A, 0);
+}
+
+/**
+ * Create a new domain with only one string. The domain takes ownership of the
+ * caller's reference to the string.
+ **/
+ason_str_dom_t *
+ason_str_dom_create_singleton(struct interned *item)
+{
+	ason_str_dom_t *ret = ason_str_dom_alloc(1, 0);
+
+	ret->items[0] = item;
+	ret->count = 1;
+
+	return ret;
+}
+
+/**
+ * Check whether a string is in a domain.
+ **/
+int
+ason_str_dom_contains(ason_str_dom_t *dom, const char *text, size_t length)
+{
+	if (! dom)
+		return 0;
+
+	return ason_str_dom_has(dom, text, length) != dom->inverted;
+}
+
+/**
+ * Comparison operation for string domains.
+ **/
+int
+ason_str_dom_compare(ason_str_dom_t *a, ason_str_dom_t *b)
+{
+	size_t i;
+	int cmp;
+
+	if (a == b)
+		return 0;
+
+	if (! a)
+		return -1;
+	if (! b)
+		return 1;
+	if (a == ASON_STR_DOM_UNIVERSE)
+		return 1;
+	if (b == ASON_STR_DOM_UNIVERSE)
+		return -1;
+
+	if (a->inverted != b->inverted)
+		return a->inverted ? 1 : -1;
+
+	for (i = 0; i < a->count && i < b->count; i++) {
+		cmp = str_compare_interned(a->items[i], b->items[i]);
+
+		if (cmp)
+			return cmp;
+	}
+
+	if (a->count != b->count)
+		return a->count < b->count ? -1 : 1;
+
+	return 0;
+}
+
+/**
+ * Destroy a string domain.
+ **/
+void
+ason_str_dom_destroy(ason_str_dom_t *dom)
+{
+	size_t i;
+
+	if (dom == ASON_STR_DOM_UNIVERSE)
+		return;
+	if (! dom)
+		return;
+
+	if (__atomic_sub_fetch(&dom->refcount, 1, __ATOMIC_ACQ_REL))
+		return;
+
+	for (i = 0; i < dom->count; i++)
+		intern_release(dom->items[i]);
+
+	str_trie_destroy(dom->trie);
+	free(dom->items);
+	free(dom);
+}
+
+/**
+ * Copy a string domain.
+ **/
+ason_str_dom_t *
+ason_str_dom_copy(ason_str_dom_t *dom)
+{
+	if (! dom)
+		return NULL;
+
+	if (dom != ASON_STR_DOM_UNIVERSE)
+		__atomic_add_fetch(&dom->refcount, 1, __ATOMIC_RELAXED);
+
+	return dom;
+}
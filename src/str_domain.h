@@ -0,0 +1,90 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef STR_DOMAIN_H
+#define STR_DOMAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "intern.h"
+
+/**
+ * A radix trie over the strings in a string domain. Each node's edges are
+ * stored together, and `labels` holds the first byte of each edge so a node's
+ * edges can be searched with memchr(). Edge text points into the domain's
+ * strings.
+ **/
+struct str_trie_edge {
+	const char *text;
+	size_t length;
+	uint32_t target;
+};
+
+struct str_trie_node {
+	uint32_t first;
+	uint16_t count;
+	uint16_t terminal;
+};
+
+struct str_trie {
+	struct str_trie_node *nodes;
+	struct str_trie_edge *edges;
+	unsigned char *labels;
+};
+
+/**
+ * A set of strings. The items array holds interned strings in sorted order
+ * without duplicates. If inverted is clear the set is just those strings,
+ * otherwise it is every string except those strings. NULL is the empty set,
+ * and ASON_STR_DOM_UNIVERSE is the set of all strings. Large domains get a
+ * trie the first time they are searched. The reference count is updated
+ * atomically, so a domain may be shared between threads.
+ **/
+typedef struct ason_str_dom {
+	struct interned **items;
+	size_t count;
+	int inverted;
+	size_t refcount;
+	struct str_trie *trie;
+} ason_str_dom_t;
+
+extern ason_str_dom_t * const ASON_STR_DOM_UNIVERSE;
+extern ason_str_dom_t ASON_STR_DOM_UNIVERSE_DATA;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ason_str_dom_t *ason_str_dom_create_singleton(struct interned *item);
+int ason_str_dom_compare(ason_str_dom_t *a, ason_str_dom_t *b);
+int ason_str_dom_contains(ason_str_dom_t *dom, const char *text,
+			  size_t length);
+void ason_str_dom_destroy(ason_str_dom_t *dom);
+ason_str_dom_t *ason_str_dom_union(ason_str_dom_t *a, ason_str_dom_t *b);
+ason_str_dom_t *ason_str_dom_intersect(ason_str_dom_t *a, ason_str_dom_t *b);
+ason_str_dom_t *ason_str_dom_invert(ason_str_dom_t *dom);
+ason_str_dom_t *ason_str_dom_copy(ason_str_dom_t *dom);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STR_DOMAIN_H */
@@ -19,9 +19,16 @@
 
 #include <iconv.h>
 #include <err.h>
+#include <errno.h>
 #include <string.h>
 #include <stdint.h>
-#include <ctype.h>
+#include <pthread.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "stringfunc.h"
 #include "util.h"
@@ -67,52 +74,220 @@ setup_locales(void)
 }
 
 /**
- * Get an iconv_t for converting input strings.
+ * A conversion descriptor kept open between uses. `to` and `from` are the
+ * encodings it was opened for, or NULL if it has not been opened.
+ **/
+struct iconv_cache {
+	iconv_t ic;
+	char *to;
+	char *from;
+};
+
+/**
+ * Each thread's cached descriptors, one for each direction we convert in.
+ **/
+struct iconv_state {
+	struct iconv_cache input;
+	struct iconv_cache output;
+};
+
+static pthread_key_t iconv_key;
+static pthread_once_t iconv_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Close a cached descriptor.
+ **/
+static void
+iconv_cache_clear(struct iconv_cache *cache)
+{
+	if (! cache->to)
+		return;
+
+	iconv_close(cache->ic);
+	free(cache->to);
+	free(cache->from);
+	cache->to = NULL;
+	cache->from = NULL;
+}
+
+/**
+ * Close a thread's cached descriptors when it exits.
+ **/
+static void
+iconv_state_free(void *data)
+{
+	struct iconv_state *state = data;
+
+	iconv_cache_clear(&state->input);
+	iconv_cache_clear(&state->output);
+	free(state);
+}
+
+/**
+ * Create the key for per-thread iconv state.
+ **/
+static void
+iconv_key_create(void)
+{
+	if (pthread_key_create(&iconv_key, iconv_state_free))
+		errx(1, "Could not create iconv thread key");
+}
+
+/**
+ * Get the calling thread's cached iconv state.
+ **/
+static struct iconv_state *
+get_iconv_state(void)
+{
+	struct iconv_state *state;
+
+	pthread_once(&iconv_key_once, iconv_key_create);
+	state = pthread_getspecific(iconv_key);
+
+	if (state)
+		return state;
+
+	state = xcalloc(1, sizeof(struct iconv_state));
+
+	if (pthread_setspecific(iconv_key, state))
+		errx(1, "Could not set iconv thread state");
+
+	return state;
+}
+
+/**
+ * Get a descriptor converting from `from` to `to` out of a cache, opening a
+ * new one if the cache is empty or holds one for other encodings. The
+ * descriptor is reset to its initial state. Always succeed.
+ **/
+static iconv_t
+cached_iconv(struct iconv_cache *cache, const char *to, const char *from)
+{
+	if (cache->to && (strcmp(cache->to, to) || strcmp(cache->from, from)))
+		iconv_cache_clear(cache);
+
+	if (cache->to) {
+		iconv(cache->ic, NULL, NULL, NULL, NULL);
+		return cache->ic;
+	}
+
+	cache->ic = xiconv_open(to, from);
+	cache->to = xstrdup(to);
+	cache->from = xstrdup(from);
+
+	return cache->ic;
+}
+
+/**
+ * Get an iconv_t for converting input strings. It belongs to the calling
+ * thread, and stays valid until the next call.
  **/
 static iconv_t
 get_input_iconv(void)
 {
 	setup_locales();
-	return xiconv_open("UTF-8", input_locale);
+	return cached_iconv(&get_iconv_state()->input, "UTF-8", input_locale);
 }
 
 /**
- * Get an iconv_t for converting output strings.
+ * Get an iconv_t for converting output strings. It belongs to the calling
+ * thread, and stays valid until the next call.
  **/
 static iconv_t
 get_output_iconv(void)
 {
 	setup_locales();
-	return xiconv_open(output_locale, "UTF-8");
+	return cached_iconv(&get_iconv_state()->output, output_locale, "UTF-8");
 }
 
 /**
- * Run iconv and convert a string of known length.
+ * Check whether a locale name refers to UTF-8.
  **/
-static char *
-string_do_convert_length(const char *in, iconv_t ic, size_t in_bytes)
+static int
+locale_is_utf8(const char *locale)
+{
+	return !strcasecmp(locale, "UTF-8") || !strcasecmp(locale, "UTF8");
+}
+
+/**
+ * Check whether input strings are already UTF-8 and need no conversion.
+ **/
+int
+string_input_is_utf8(void)
 {
-	char *my_in = xmalloc(in_bytes);
-	char *my_in_mem = my_in;
+	setup_locales();
+	return locale_is_utf8(input_locale);
+}
 
-	char *out = xmalloc(6 * in_bytes); /* Max UTF-8 expansion */
-	char *ret = out;
+/**
+ * Check whether output strings should be UTF-8 and need no conversion.
+ **/
+static int
+string_output_is_utf8(void)
+{
+	setup_locales();
+	return locale_is_utf8(output_locale);
+}
 
-	size_t out_bytes = 6 * in_bytes + 1;
-	size_t out_bytes_start = out_bytes;
+/**
+ * Extra room we give a conversion beyond the length of its input.
+ **/
+#define CONVERT_SLACK 16
 
+/**
+ * Run iconv and convert a string of known length. The result is always
+ * terminated, and its length, less the terminator, is stored in `out_len` if
+ * it is not NULL. We convert straight into the result, starting with room for
+ * about as many bytes as the input and doubling it whenever it fills.
+ **/
+static char *
+string_do_convert_length(const char *in, iconv_t ic, size_t in_bytes,
+			 size_t *out_len)
+{
+	char *in_pos = (char *)in;
+	size_t size = in_bytes + CONVERT_SLACK;
+	char *ret = xmalloc(size);
+	size_t length = 0;
+	size_t out_bytes;
+	char *out;
 	size_t got;
+	int flush = 0;
 
-	memcpy(my_in, in, in_bytes);
-	got = iconv(ic, &my_in, &in_bytes, &out, &out_bytes);
+	for (;;) {
+		out = ret + length;
+		out_bytes = size - length - 1;
 
-	if (in_bytes)
-		err(1, "String conversion left %zd bytes, returned %zd",
-		    in_bytes, got);
+		/* Once the input is used up, flush any shift state. */
+		if (flush)
+			got = iconv(ic, NULL, NULL, &out, &out_bytes);
+		else
+			got = iconv(ic, &in_pos, &in_bytes, &out, &out_bytes);
 
-	free(my_in_mem);
+		length = out - ret;
 
-	return xrealloc(ret, out_bytes_start - out_bytes);
+		if (got == (size_t)-1 && errno == E2BIG) {
+			size *= 2;
+			ret = xrealloc(ret, size);
+			continue;
+		}
+
+		if (got == (size_t)-1 || in_bytes)
+			err(1, "String conversion left %zd bytes, returned %zd",
+			    in_bytes, got);
+
+		if (flush)
+			break;
+
+		flush = 1;
+	}
+
+	ret = xrealloc(ret, length + 1);
+	ret[length] = '\0';
+
+	if (out_len)
+		*out_len = length;
+
+	return ret;
 }
 
 /**
@@ -123,7 +298,7 @@ string_do_convert(const char *in, iconv_t ic)
 {
 	size_t in_sz = locale_str_buflen(in);
 
-	return string_do_convert_length(in, ic, in_sz);
+	return string_do_convert_length(in, ic, in_sz, NULL);
 }
 
 /**
@@ -132,10 +307,29 @@ string_do_convert(const char *in, iconv_t ic)
 char *
 string_to_utf8(const char *in)
 {
-	iconv_t ic = get_input_iconv();
-	char *ret = string_do_convert(in, ic);
+	if (string_input_is_utf8())
+		return xstrdup(in);
 
-	iconv_close(ic);
+	return string_do_convert(in, get_input_iconv());
+}
+
+/**
+ * Convert a string of `*length` bytes from our input locale to UTF-8. The
+ * string need not be terminated. The length of the result is stored back into
+ * `length`.
+ **/
+char *
+string_to_utf8_n(const char *in, size_t *length)
+{
+	char *ret;
+
+	if (! string_input_is_utf8())
+		return string_do_convert_length(in, get_input_iconv(), *length,
+						length);
+
+	ret = xmalloc(*length + 1);
+	memcpy(ret, in, *length);
+	ret[*length] = '\0';
 	return ret;
 }
 
@@ -145,170 +339,425 @@ string_to_utf8(const char *in)
 char *
 string_from_utf8(const char *in)
 {
-	iconv_t ic = get_output_iconv();
-	char *ret = string_do_convert(in, ic);
+	if (string_output_is_utf8())
+		return xstrdup(in);
 
-	iconv_close(ic);
-	return ret;
+	return string_do_convert(in, get_output_iconv());
 }
 
 /**
- * Get an escaped version of a string.
+ * Check whether a byte must be escaped. Everything outside of printable ASCII
+ * is, along with the quote, backslash and slash.
  **/
-char *
-string_escape(const char *in)
+static inline int
+escape_needed(unsigned char c)
 {
-	/* There's a char32_t in newer C standards. Use it? */
-	uint32_t *expanded_buf;
-	size_t chars = strlen(in);
-	iconv_t ic = xiconv_open("UTF-32", "UTF-8");
-	char *ret;
-	char *pos;
+	return c < 0x20 || c >= 0x7f || c == '"' || c == '\\' || c == '/';
+}
+
+#if defined(__AVX2__)
+
+/**
+ * Find bytes which must be escaped among 32 bytes of input. A signed compare
+ * against 0x20 catches control characters and every byte of a multibyte
+ * character at once.
+ **/
+static inline uint32_t
+escape_mask_32(const char *in)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i *)in);
+	__m256i m = _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v);
+
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f)));
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')));
+
+	return _mm256_movemask_epi8(m);
+}
+
+#define ESCAPE_BLOCK 32
+#define escape_mask escape_mask_32
+
+#elif defined(__SSE2__)
+
+/**
+ * Find bytes which must be escaped among 16 bytes of input. A signed compare
+ * against 0x20 catches control characters and every byte of a multibyte
+ * character at once.
+ **/
+static inline uint32_t
+escape_mask_16(const char *in)
+{
+	__m128i v = _mm_loadu_si128((const __m128i *)in);
+	__m128i m = _mm_cmplt_epi8(v, _mm_set1_epi8(0x20));
+
+	m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)));
+	m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+	m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+	m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+
+	return _mm_movemask_epi8(m);
+}
+
+#define ESCAPE_BLOCK 16
+#define escape_mask escape_mask_16
+
+#endif
+
+/**
+ * Find the first byte at or after `in` which must be escaped. Return `end` if
+ * there is none.
+ **/
+static inline const char *
+escape_scan(const char *in, const char *end)
+{
+#ifdef ESCAPE_BLOCK
+	uint32_t mask;
+
+	for (; end - in >= ESCAPE_BLOCK; in += ESCAPE_BLOCK)
+		if ((mask = escape_mask(in)))
+			return in + __builtin_ctz(mask);
+#endif
+
+	while (in < end && ! escape_needed(*in))
+		in++;
+
+	return in;
+}
+
+/**
+ * Decode one UTF-8 character into `c`. Return the number of bytes it takes
+ * up. Bytes which do not start a well-formed character decode one at a time
+ * as U+FFFD.
+ **/
+static size_t
+get_utf8(const char *in, const char *end, uint32_t *c)
+{
+	const unsigned char *u = (const unsigned char *)in;
+	size_t avail = end - in;
+	size_t length;
+	uint32_t min;
 	size_t i;
 
-	expanded_buf = (uint32_t *)string_do_convert(in, ic);
+	if (u[0] >= 0xc2 && u[0] <= 0xdf) {
+		length = 2;
+		min = 0x80;
+		*c = u[0] & 0x1f;
+	} else if (u[0] >= 0xe0 && u[0] <= 0xef) {
+		length = 3;
+		min = 0x800;
+		*c = u[0] & 0x0f;
+	} else if (u[0] >= 0xf0 && u[0] <= 0xf4) {
+		length = 4;
+		min = 0x10000;
+		*c = u[0] & 0x07;
+	} else {
+		goto bad;
+	}
 
-	iconv_close(ic);
+	if (avail < length)
+		goto bad;
 
-	/* Again, max expansion, for a different reason. We can represent a
-	 * single byte character as '\ub33f'. */
-	ret = xmalloc(6 * chars + 1);
-	pos = ret;
+	for (i = 1; i < length; i++) {
+		if ((u[i] & 0xc0) != 0x80)
+			goto bad;
 
-	/* i = 1 due to UTF-32 BOM */
-	for (i = 1; i < chars + 1; i++) {
-		if (expanded_buf[i] & 0xffffff80) {
-			pos += sprintf(pos, "\\u%04x", expanded_buf[i]);
-			continue;
-		}
+		*c = (*c << 6) | (u[i] & 0x3f);
+	}
 
-		if (! expanded_buf[i]) {
-			chars = i;
+	if (*c < min || *c > 0x10ffff || (*c >= 0xd800 && *c <= 0xdfff))
+		goto bad;
+
+	return length;
+
+bad:
+	*c = 0xfffd;
+	return 1;
+}
+
+/**
+ * Write a `\uXXXX` escape. Return a pointer past it.
+ **/
+static inline char *
+put_u_escape(char *out, uint32_t c)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	out[0] = '\\';
+	out[1] = 'u';
+	out[2] = hex[(c >> 12) & 0xf];
+	out[3] = hex[(c >> 8) & 0xf];
+	out[4] = hex[(c >> 4) & 0xf];
+	out[5] = hex[c & 0xf];
+
+	return out + 6;
+}
+
+/**
+ * Append an escaped version of `length` bytes of UTF-8 to a buffer.
+ * Everything outside of printable ASCII is escaped, characters beyond the
+ * basic multilingual plane as surrogate pairs. Runs of characters which need
+ * no escaping are found a block at a time and appended whole. Nothing is
+ * allocated unless the buffer itself grows.
+ **/
+void
+string_escape_to_buffer(struct buffer *buf, const char *in, size_t length)
+{
+	const char *end = in + length;
+	const char *clean;
+	/* Room for a surrogate pair. */
+	char esc[12];
+	char *out;
+	uint32_t c;
+
+	for (;;) {
+		clean = escape_scan(in, end);
+		buffer_append(buf, in, clean - in);
+		in = clean;
+
+		if (in == end)
 			break;
-		}
 
-		switch (expanded_buf[i]) {
+		out = esc;
+
+		switch (*in) {
 		case '\"':
-			pos += sprintf(pos, "\\\"");
-			break;
 		case '\\':
-			pos += sprintf(pos, "\\\\");
-			break;
 		case '/':
-			pos += sprintf(pos, "\\/");
-			break;
+			esc[0] = '\\';
+			esc[1] = *(in++);
+			buffer_append(buf, esc, 2);
+			continue;
 		case '\b':
-			pos += sprintf(pos, "\\b");
+			c = 'b';
 			break;
 		case '\f':
-			pos += sprintf(pos, "\\f");
+			c = 'f';
 			break;
 		case '\n':
-			pos += sprintf(pos, "\\n");
+			c = 'n';
 			break;
 		case '\r':
-			pos += sprintf(pos, "\\r");
+			c = 'r';
 			break;
 		case '\t':
-			pos += sprintf(pos, "\\t");
+			c = 't';
 			break;
 		case '\v':
-			pos += sprintf(pos, "\\v");
+			c = 'v';
 			break;
 		default:
-			if (iscntrl(expanded_buf[i]))
-				pos += sprintf(pos, "\\u%04x",
-					       expanded_buf[i]);
-			else
-				pos += sprintf(pos, "%c",
-					       (char)expanded_buf[i]);
-		};
-	}
+			c = 0;
+		}
 
-	*pos = '\0';
-	free(expanded_buf);
-	return xrealloc(ret, strlen(ret) + 1);
+		if (c) {
+			esc[0] = '\\';
+			esc[1] = c;
+			buffer_append(buf, esc, 2);
+			in++;
+			continue;
+		}
+
+		if ((unsigned char)*in < 0x80) {
+			out = put_u_escape(out, *(in++));
+			buffer_append(buf, esc, out - esc);
+			continue;
+		}
+
+		in += get_utf8(in, end, &c);
+
+		if (c >= 0x10000) {
+			c -= 0x10000;
+			out = put_u_escape(out, 0xd800 | (c >> 10));
+			c = 0xdc00 | (c & 0x3ff);
+		}
+
+		out = put_u_escape(out, c);
+		buffer_append(buf, esc, out - esc);
+	}
 }
 
 /**
- * Unescape an escaped string.
+ * Get an escaped version of a UTF-8 string.
  **/
 char *
-string_unescape(const char *in)
+string_escape(const char *in)
 {
-	size_t len = strlen(in) + 1;
-	iconv_t ic = xiconv_open("UTF-32", "UTF-8");
-	uint32_t *in_exp = (uint32_t *)string_do_convert(in, ic);
-	uint32_t *out_exp = xcalloc(len + 1, sizeof(uint32_t));
-	uint32_t *in_pos = in_exp;
-	uint32_t *out_pos = out_exp;
-	char tmp_str[5];
-	char *ret;
-	size_t i;
+	size_t length = strlen(in);
+	/* No character needs more than 6 bytes per input byte, so the buffer
+	 * never has to grow. */
+	ason_buffer_t out = { xmalloc(6 * length + 1), 0, 6 * length + 1 };
+	struct buffer buf = { .out = &out };
 
-	iconv_close(ic);
+	out.data[0] = '\0';
+	string_escape_to_buffer(&buf, in, length);
 
-	/* Copy over UTF-32 BOM */
-	*out_pos = *in_pos;
-	out_pos++;
-	in_pos++;
+	return xrealloc(out.data, out.length + 1);
+}
 
-	for(; *in_pos; out_pos++, in_pos++) {
-		if (*in_pos != '\\') {
-			*out_pos = *in_pos;
-			continue;
-		}
+/**
+ * Read four hex digits. Return -1 if they are not all hex digits.
+ **/
+static long
+read_hex4(const char *in)
+{
+	long ret = 0;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		ret <<= 4;
+
+		if (in[i] >= '0' && in[i] <= '9')
+			ret |= in[i] - '0';
+		else if (in[i] >= 'a' && in[i] <= 'f')
+			ret |= in[i] - 'a' + 10;
+		else if (in[i] >= 'A' && in[i] <= 'F')
+			ret |= in[i] - 'A' + 10;
+		else
+			return -1;
+	}
 
-		in_pos++;
+	return ret;
+}
 
-		switch (*in_pos) {
+/**
+ * Write a code point as UTF-8. Return the number of bytes written.
+ **/
+static size_t
+put_utf8(char *out, uint32_t c)
+{
+	if (c < 0x80) {
+		out[0] = c;
+		return 1;
+	}
+
+	if (c < 0x800) {
+		out[0] = 0xc0 | (c >> 6);
+		out[1] = 0x80 | (c & 0x3f);
+		return 2;
+	}
+
+	if (c < 0x10000) {
+		out[0] = 0xe0 | (c >> 12);
+		out[1] = 0x80 | ((c >> 6) & 0x3f);
+		out[2] = 0x80 | (c & 0x3f);
+		return 3;
+	}
+
+	out[0] = 0xf0 | (c >> 18);
+	out[1] = 0x80 | ((c >> 12) & 0x3f);
+	out[2] = 0x80 | ((c >> 6) & 0x3f);
+	out[3] = 0x80 | (c & 0x3f);
+	return 4;
+}
+
+/**
+ * Read the hex digits of a `\u` escape at `*in`, along with the escape for the
+ * low half of a surrogate pair if one is needed. Move `*in` past them and
+ * return the code point, or return -1 if the escape is invalid. Strings are
+ * NUL-terminated once unescaped, so `\u0000` is invalid too.
+ **/
+long
+string_read_u_escape(const char **in, const char *end)
+{
+	const char *pos = *in;
+	long c;
+	long low;
+
+	if (end - pos < 4 || (c = read_hex4(pos)) < 0)
+		return -1;
+
+	pos += 4;
+
+	if (! c || (c >= 0xdc00 && c < 0xe000))
+		return -1;
+
+	if (c >= 0xd800 && c < 0xdc00) {
+		if (end - pos < 6 || pos[0] != '\\' || pos[1] != 'u')
+			return -1;
+
+		low = read_hex4(pos + 2);
+
+		if (low < 0xdc00 || low >= 0xe000)
+			return -1;
+
+		pos += 6;
+		c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+	}
+
+	*in = pos;
+	return c;
+}
+
+/**
+ * Unescape an escaped UTF-8 string of `length` bytes. The result is never
+ * longer than the input, since no escape is shorter than what it encodes.
+ * Return NULL if the string contains an invalid escape.
+ **/
+char *
+string_unescape(const char *in, size_t length)
+{
+	const char *end = in + length;
+	const char *bs;
+	char *ret = xmalloc(length + 1);
+	char *out = ret;
+	long c;
+
+	while ((bs = memchr(in, '\\', end - in))) {
+		memcpy(out, in, bs - in);
+		out += bs - in;
+		in = bs + 1;
+
+		if (in == end)
+			goto fail;
+
+		switch (*(in++)) {
 		case '\"':
+			*(out++) = '\"';
+			break;
 		case '\\':
+			*(out++) = '\\';
+			break;
 		case '/':
-			*out_pos = *in_pos;
+			*(out++) = '/';
 			break;
 		case 'b':
-			*out_pos = '\b';
+			*(out++) = '\b';
 			break;
 		case 'f':
-			*out_pos = '\f';
+			*(out++) = '\f';
 			break;
 		case 'n':
-			*out_pos = '\n';
+			*(out++) = '\n';
 			break;
 		case 'r':
-			*out_pos = '\r';
+			*(out++) = '\r';
 			break;
 		case 't':
-			*out_pos = '\t';
+			*(out++) = '\t';
 			break;
 		case 'v':
-			*out_pos = '\v';
+			*(out++) = '\v';
 			break;
 		case 'u':
-			for (i = 0; i < 4; i++)
-				tmp_str[i] = (char)*(++in_pos);
+			if ((c = string_read_u_escape(&in, end)) < 0)
+				goto fail;
 
-			tmp_str[4] = '\0';
-
-			if (sscanf(tmp_str, "%04x", out_pos) > 0)
-				break;
+			out += put_utf8(out, c);
+			break;
 		default:
-			errx(1, "Unexpected escape sequence");
+			goto fail;
 		}
 	}
 
-	*out_pos = 0;
-
-	ic = xiconv_open("UTF-8", "UTF-32");
+	memcpy(out, in, end - in);
+	out += end - in;
+	*out = '\0';
 
-	ret = string_do_convert_length((char *)out_exp, ic,
-				       (len + 1) * sizeof(uint32_t));
+	return xrealloc(ret, out - ret + 1);
 
-	iconv_close(ic);
-
-	free(out_exp);
-	free(in_exp);
-
-	return ret;
+fail:
+	free(ret);
+	return NULL;
 }
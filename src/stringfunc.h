@@ -20,14 +20,26 @@
 #ifndef STRINGFUNC_H
 #define STRINGFUNC_H
 
+#include <stddef.h>
+
+#include "buffer.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+extern const char *input_locale;
+extern const char *output_locale;
+
 char *string_to_utf8(const char *in);
+char *string_to_utf8_n(const char *in, size_t *length);
+int string_input_is_utf8(void);
 char *string_from_utf8(const char *in);
 char *string_escape(const char *in);
-char *string_unescape(const char *in);
+void string_escape_to_buffer(struct buffer *buf, const char *in,
+			     size_t length);
+char *string_unescape(const char *in, size_t length);
+long string_read_u_escape(const char **in, const char *end);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,120 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdlib.h>
+
+#include "symtab.h"
+#include "util.h"
+
+/**
+ * Number of slots a symbol table starts with. Always a power of two.
+ **/
+#define SYMTAB_MIN_SIZE 16
+
+/**
+ * Find the slot holding a symbol, or the empty slot where it belongs.
+ **/
+static struct symbol *
+symtab_find(struct symtab *table, struct interned *name)
+{
+	size_t mask = table->size - 1;
+	size_t i = name->hash & mask;
+
+	while (table->slots[i].name && table->slots[i].name != name)
+		i = (i + 1) & mask;
+
+	return &table->slots[i];
+}
+
+/**
+ * Double the number of slots in a symbol table.
+ **/
+static void
+symtab_grow(struct symtab *table)
+{
+	struct symbol *old = table->slots;
+	size_t old_size = table->size;
+	size_t i;
+
+	table->size *= 2;
+	table->slots = xcalloc(table->size, sizeof(struct symbol));
+
+	for (i = 0; i < old_size; i++)
+		if (old[i].name)
+			*symtab_find(table, old[i].name) = old[i];
+
+	free(old);
+}
+
+/**
+ * Create an empty symbol table.
+ **/
+struct symtab *
+symtab_create(void)
+{
+	struct symtab *ret = xcalloc(1, sizeof(struct symtab));
+
+	ret->size = SYMTAB_MIN_SIZE;
+	ret->slots = xcalloc(ret->size, sizeof(struct symbol));
+
+	return ret;
+}
+
+/**
+ * Free a symbol table, its references to its names, and the values loaded for
+ * its symbols.
+ **/
+void
+symtab_destroy(struct symtab *table)
+{
+	size_t i;
+
+	for (i = 0; i < table->size; i++) {
+		if (! table->slots[i].name)
+			continue;
+
+		intern_release(table->slots[i].name);
+		ason_destroy(table->slots[i].value);
+	}
+
+	free(table->slots);
+	free(table);
+}
+
+/**
+ * Get the symbol for a name, adding it to the table if this is the first time
+ * we've seen it. The returned pointer is only valid until the next call.
+ **/
+struct symbol *
+symtab_get(struct symtab *table, struct interned *name)
+{
+	struct symbol *sym;
+
+	if ((table->count + 1) * 2 > table->size)
+		symtab_grow(table);
+
+	sym = symtab_find(table, name);
+
+	if (! sym->name) {
+		sym->name = intern_ref(name);
+		table->count++;
+	}
+
+	return sym;
+}
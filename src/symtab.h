@@ -0,0 +1,61 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef SYMTAB_H
+#define SYMTAB_H
+
+#include <stddef.h>
+
+#include <ason/ason.h>
+
+#include "intern.h"
+
+/**
+ * A symbol which has appeared in some ASON text, and the value it was loaded
+ * with, or NULL if it has not been loaded yet.
+ **/
+struct symbol {
+	struct interned *name;
+	ason_t *value;
+};
+
+/**
+ * The distinct symbols in some ASON text. Names come from the intern pool, so
+ * a symbol is found by comparing pointers, and is placed by the hash the pool
+ * already computed for it. The table holds a reference to each name.
+ **/
+struct symtab {
+	struct symbol *slots;
+	size_t size;
+	size_t count;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct symtab *symtab_create(void);
+void symtab_destroy(struct symtab *table);
+struct symbol *symtab_get(struct symtab *table, struct interned *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYMTAB_H */
@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <string.h>
 #include <err.h>
 
@@ -37,6 +38,8 @@
 #define FP_BITS (1 << 16)
 #define TO_FP(x) ( (int64_t)((x) * FP_BITS) )
 #define FP_WHOLE(x) ( (x) / FP_BITS )
+#define FP_WHOLE_MAX (INT64_MAX / FP_BITS)
+#define FP_WHOLE_MIN (INT64_MIN / FP_BITS)
 
 #ifdef __cplusplus
 extern "C" {
@@ -46,6 +46,7 @@ API_EXPORT ason_t * const ASON_NULL = &ASON_NULL_DATA;
 static struct ason ASON_UNIVERSE_DATA = {
 	.atoms = ATOM_TRUE | ATOM_FALSE | ATOM_NULL,
 	.num_dom = &ASON_NUM_DOM_UNIVERSE_DATA,
+	.str_dom = &ASON_STR_DOM_UNIVERSE_DATA,
 };
 API_EXPORT ason_t * const ASON_UNIVERSE = &ASON_UNIVERSE_DATA;
 
@@ -64,6 +65,7 @@ API_EXPORT ason_t * const ASON_FALSE = &ASON_FALSE_DATA;
 static struct ason ASON_WILD_DATA = {
 	.atoms = ATOM_TRUE | ATOM_FALSE,
 	.num_dom = &ASON_NUM_DOM_UNIVERSE_DATA,
+	.str_dom = &ASON_STR_DOM_UNIVERSE_DATA,
 };
 API_EXPORT ason_t * const ASON_WILD = &ASON_WILD_DATA;
 
@@ -79,8 +81,12 @@ API_EXPORT ason_t * const ASON_OBJ_ANY = &ASON_OBJ_ANY_DATA;
 ason_t *
 ason_create_string(const char *string)
 {
-	(void)string;
-	return ASON_EMPTY;
+	ason_t *ret = xcalloc(1, sizeof(ason_t));
+	ret->refcount = 1;
+
+	ret->str_dom = ason_str_dom_create_singleton(intern(string,
+							    strlen(string)));
+	return ret;
 }
 
 /**
@@ -98,7 +104,7 @@ ason_copy(ason_t *a)
 	    a == ASON_OBJ_ANY)
 		return a;
 
-	a->refcount++;
+	__atomic_add_fetch(&a->refcount, 1, __ATOMIC_RELAXED);
 	return a;
 }
 
@@ -118,9 +124,13 @@ ason_destroy(ason_t *a)
 	    a == ASON_OBJ_ANY	||
 	    a == ASON_TRUE	||
 	    a == ASON_FALSE	||
-	    --a->refcount)
+	    __atomic_sub_fetch(&a->refcount, 1, __ATOMIC_ACQ_REL))
 		return;
 
+	if (a->lazy)
+		ason_lazy_release(a->lazy);
+
+	ason_str_dom_destroy(a->str_dom);
 	free(a);
 }
 
@@ -170,6 +180,136 @@ ason_create_object(const char *key, ason_t *value)
 	return ASON_EMPTY;
 }
 
+/**
+ * Create an ASON list value from an array of items.
+ **/
+ason_t *
+ason_create_list_n(ason_t **items, size_t count)
+{
+	(void)items;
+	(void)count;
+	return ASON_EMPTY;
+}
+
+/**
+ * Create an ASON object value from an array of key-value pairs.
+ **/
+ason_t *
+ason_create_object_n(struct kv_pair *pairs, size_t count)
+{
+	(void)pairs;
+	(void)count;
+	return ASON_EMPTY;
+}
+
+/**
+ * Start building a list.
+ **/
+struct list_builder *
+list_builder_create(void)
+{
+	return xcalloc(1, sizeof(struct list_builder));
+}
+
+/**
+ * Add an item to the end of a list being built. The builder takes ownership
+ * of the item.
+ **/
+void
+list_builder_append(struct list_builder *builder, ason_t *item)
+{
+	if (builder->count == builder->size) {
+		builder->size = builder->size ? builder->size * 2 : 8;
+		builder->items = xrealloc(builder->items, builder->size *
+					  sizeof(ason_t *));
+	}
+
+	builder->items[builder->count++] = item;
+}
+
+/**
+ * Create the list a builder describes and free the builder.
+ **/
+ason_t *
+list_builder_finish(struct list_builder *builder)
+{
+	ason_t *ret = ason_create_list_n(builder->items, builder->count);
+
+	list_builder_destroy(builder);
+	return ret;
+}
+
+/**
+ * Free a list builder and the items in it.
+ **/
+void
+list_builder_destroy(struct list_builder *builder)
+{
+	size_t i;
+
+	for (i = 0; i < builder->count; i++)
+		ason_destroy(builder->items[i]);
+
+	free(builder->items);
+	free(builder);
+}
+
+/**
+ * Start building an object.
+ **/
+struct object_builder *
+object_builder_create(void)
+{
+	return xcalloc(1, sizeof(struct object_builder));
+}
+
+/**
+ * Add a key-value pair to an object being built. The builder takes ownership
+ * of both the value and the caller's reference to the key.
+ **/
+void
+object_builder_append(struct object_builder *builder, struct interned *key,
+		      ason_t *value)
+{
+	if (builder->count == builder->size) {
+		builder->size = builder->size ? builder->size * 2 : 8;
+		builder->pairs = xrealloc(builder->pairs, builder->size *
+					  sizeof(struct kv_pair));
+	}
+
+	builder->pairs[builder->count].key = key;
+	builder->pairs[builder->count++].value = value;
+}
+
+/**
+ * Create the object a builder describes and free the builder.
+ **/
+ason_t *
+object_builder_finish(struct object_builder *builder)
+{
+	ason_t *ret = ason_create_object_n(builder->pairs, builder->count);
+
+	object_builder_destroy(builder);
+	return ret;
+}
+
+/**
+ * Free an object builder and the pairs in it.
+ **/
+void
+object_builder_destroy(struct object_builder *builder)
+{
+	size_t i;
+
+	for (i = 0; i < builder->count; i++) {
+		intern_release(builder->pairs[i].key);
+		ason_destroy(builder->pairs[i].value);
+	}
+
+	free(builder->pairs);
+	free(builder);
+}
+
 /**
  * Union two ASON values.
  **/
@@ -178,14 +318,37 @@ ason_union(ason_t *a, ason_t *b)
 {
 	ason_t *ret;
 
+	ason_materialize(a);
+	ason_materialize(b);
+
 	ret = xcalloc(1, sizeof(ason_t));
 	ret->refcount = 1;
 	ret->num_dom = ason_num_dom_union(a->num_dom, b->num_dom);
+	ret->str_dom = ason_str_dom_union(a->str_dom, b->str_dom);
 	ret->atoms = a->atoms | b->atoms;
 
 	return ret;
 }
 
+/**
+ * Union an array of ASON values. The values are merged in a balanced tree, so
+ * no value takes part in more than log2(count) merges.
+ **/
+ason_t *
+ason_union_n(ason_t **values, size_t count)
+{
+	size_t half = count / 2;
+
+	if (! count)
+		return ASON_EMPTY;
+
+	if (count == 1)
+		return ason_copy(values[0]);
+
+	return ason_union_d(ason_union_n(values, half),
+			    ason_union_n(values + half, count - half));
+}
+
 /**
  * Intersect two ASON values.
  **/
@@ -194,14 +357,37 @@ ason_intersect(ason_t *a, ason_t *b)
 {
 	ason_t *ret;
 
+	ason_materialize(a);
+	ason_materialize(b);
+
 	ret = xcalloc(1, sizeof(ason_t));
 	ret->refcount = 1;
 	ret->num_dom = ason_num_dom_intersect(a->num_dom, b->num_dom);
+	ret->str_dom = ason_str_dom_intersect(a->str_dom, b->str_dom);
 	ret->atoms = a->atoms & b->atoms;
 
 	return ret;
 }
 
+/**
+ * Intersect an array of ASON values. The values are merged in a balanced
+ * tree, so no value takes part in more than log2(count) merges.
+ **/
+ason_t *
+ason_intersect_n(ason_t **values, size_t count)
+{
+	size_t half = count / 2;
+
+	if (! count)
+		return ASON_UNIVERSE;
+
+	if (count == 1)
+		return ason_copy(values[0]);
+
+	return ason_intersect_d(ason_intersect_n(values, half),
+				ason_intersect_n(values + half, count - half));
+}
+
 /**
  * Join ASON value b to a.
  **/
@@ -219,9 +405,12 @@ ason_complement(ason_t *a)
 {
 	ason_t *ret;
 
+	ason_materialize(a);
+
 	ret = xcalloc(1, sizeof(ason_t));
 	ret->refcount = 1;
 	ret->num_dom = ason_num_dom_invert(a->num_dom);
+	ret->str_dom = ason_str_dom_invert(a->str_dom);
 	ret->atoms = (~a->atoms) & (ATOM_TRUE | ATOM_FALSE | ATOM_NULL);
 
 	return ret;
@@ -272,7 +461,11 @@ ason_check_represented_in(ason_t *a, ason_t *b)
 API_EXPORT int
 ason_check_equal(ason_t *a, ason_t *b)
 {
-	return !ason_num_dom_compare(a->num_dom, b->num_dom);
+	ason_materialize(a);
+	ason_materialize(b);
+
+	return !ason_num_dom_compare(a->num_dom, b->num_dom) &&
+		!ason_str_dom_compare(a->str_dom, b->str_dom);
 }
 
 /**
@@ -281,7 +474,7 @@ ason_check_equal(ason_t *a, ason_t *b)
 API_EXPORT ason_type_t
 ason_type(ason_t *a)
 {
-	(void)a;
+	ason_materialize(a);
 	return ASON_TYPE_UNION;
 }
 
@@ -27,22 +27,66 @@
 #include <ason/ason.h>
 
 #include "num_domain.h"
+#include "str_domain.h"
+#include "intern.h"
 
 /**
- * A Key-value pair.
+ * A Key-value pair. The key is interned, so keys can be compared by pointer.
  **/
 struct kv_pair {
-	char *key;
+	struct interned *key;
 	ason_t *value;
 };
 
 /**
- * Data making up a value.
+ * A list being assembled one item at a time. Items are owned by the builder
+ * until it is finished.
+ **/
+struct list_builder {
+	ason_t **items;
+	size_t count;
+	size_t size;
+};
+
+/**
+ * An object being assembled one key-value pair at a time.
+ **/
+struct object_builder {
+	struct kv_pair *pairs;
+	size_t count;
+	size_t size;
+};
+
+/**
+ * Text which lazily read values were read from. It is kept until every value
+ * waiting to be decoded from it has been decoded or destroyed.
+ **/
+struct lazy_source {
+	char *text;
+	size_t length;
+	size_t refcount;
+};
+
+/**
+ * Where to find the text of a lazily read value.
+ **/
+struct ason_lazy {
+	struct lazy_source *source;
+	size_t start;
+	size_t length;
+};
+
+/**
+ * Data making up a value. If `lazy` is set, the value has not been decoded
+ * yet, and the other fields are not valid until ason_materialize() is called.
+ * The reference count is updated atomically.
  **/
 struct ason {
 	int atoms;
 	ason_num_dom_t *num_dom;
+	ason_str_dom_t *str_dom;
 	size_t refcount;
+	struct ason_lazy *lazy;
 };
 
 /**
@@ -60,9 +104,13 @@ ason_t *ason_create_number(int64_t number);
 ason_t *ason_create_list(ason_t *content);
 ason_t *ason_append_lists(ason_t *list, ason_t *item);
 ason_t *ason_create_object(const char *key, ason_t *value); 
+ason_t *ason_create_list_n(ason_t **items, size_t count);
+ason_t *ason_create_object_n(struct kv_pair *pairs, size_t count);
 ason_t *ason_create_string(const char *str);
 ason_t *ason_union(ason_t *a, ason_t *b);
 ason_t *ason_intersect(ason_t *a, ason_t *b);
+ason_t *ason_union_n(ason_t **values, size_t count);
+ason_t *ason_intersect_n(ason_t **values, size_t count);
 ason_t *ason_join(ason_t *a, ason_t *b);
 ason_t *ason_complement(ason_t *a);
 ason_t *ason_representation_in(ason_t *a, ason_t *b);
@@ -71,6 +119,31 @@ ason_t *ason_equality(ason_t *a, ason_t *b);
 ason_t * ason_create_fixnum(int64_t number);
 int ason_reduce(ason_t *value);
 
+void ason_lazy_decode(ason_t *value);
+void ason_lazy_release(struct ason_lazy *lazy);
+
+/**
+ * Make sure a value has been decoded, if it was read lazily. Anything which
+ * looks inside a value must call this first.
+ **/
+static inline void
+ason_materialize(ason_t *value)
+{
+	if (value->lazy)
+		ason_lazy_decode(value);
+}
+
+struct list_builder *list_builder_create(void);
+void list_builder_append(struct list_builder *builder, ason_t *item);
+ason_t *list_builder_finish(struct list_builder *builder);
+void list_builder_destroy(struct list_builder *builder);
+
+struct object_builder *object_builder_create(void);
+void object_builder_append(struct object_builder *builder,
+			   struct interned *key, ason_t *value);
+ason_t *object_builder_finish(struct object_builder *builder);
+void object_builder_destroy(struct object_builder *builder);
+
 /* Destructive operators */
 
 static inline ason_t *
@@ -0,0 +1,110 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <err.h>
+
+#include "../src/crc.h"
+
+#define BUFFER_BYTES (64 << 20)
+#define BITWISE_BYTES (1 << 20)
+#define RUNS 10
+
+/**
+ * Get the current time in seconds.
+ **/
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Checksum with the table-driven implementation only.
+ **/
+static uint64_t
+crc_table(unsigned char *data, size_t size)
+{
+	return crc64_update_table(crc64_init(), data, size);
+}
+
+/**
+ * Checksum on one thread per CPU.
+ **/
+static uint64_t
+crc_parallel(unsigned char *data, size_t size)
+{
+	return crc64_parallel(data, size, 0);
+}
+
+/**
+ * Time checksumming a buffer, check the result, and report throughput.
+ **/
+static void
+bench_crc(const char *name, uint64_t (*crc)(unsigned char *, size_t),
+	  unsigned char *data, size_t size, uint64_t expect)
+{
+	double start = now();
+	double elapsed;
+	int i;
+
+	for (i = 0; i < RUNS; i++)
+		if (crc(data, size) != expect)
+			errx(1, "%s: wrong checksum", name);
+
+	elapsed = now() - start;
+	printf("%-16s %10.2f MB/s\n", name, size * (double)RUNS / elapsed / 1e6);
+}
+
+/**
+ * CRC-64 throughput benchmarks.
+ **/
+int
+main(void)
+{
+	unsigned char *data = malloc(BUFFER_BYTES);
+	uint64_t expect;
+	size_t i;
+
+	if (! data)
+		errx(1, "Malloc failed");
+
+	srand(1);
+
+	for (i = 0; i < BUFFER_BYTES; i++)
+		data[i] = rand();
+
+	expect = crc64_bitwise(data, BITWISE_BYTES);
+	bench_crc("bitwise", crc64_bitwise, data, BITWISE_BYTES, expect);
+	bench_crc("table", crc_table, data, BITWISE_BYTES, expect);
+
+	expect = crc64(data, BUFFER_BYTES);
+	bench_crc("dispatched", crc64, data, BUFFER_BYTES, expect);
+	bench_crc("parallel", crc_parallel, data, BUFFER_BYTES, expect);
+
+	free(data);
+	return 0;
+}
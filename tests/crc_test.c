@@ -19,18 +19,27 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <endian.h>
 
 #include "../src/crc.h"
 #include "harness.h"
 
-TESTS(2);
+TESTS(9);
 
 /**
  * Basic exercise of the parser.
  **/
 TEST_MAIN("CRC")
 {
+	unsigned char data[1024];
+	uint64_t word;
+	uint64_t crc;
+	unsigned char *big = NULL;
+	size_t big_size = (5 << 20) + 13;
+	size_t i;
+	size_t j;
+
 	TEST("Single-word CRC") {
 		REQUIRE(crc64_8h(0x123456789abcdef0) == 0x13e76db181b0d129);
 	}
@@ -42,6 +51,93 @@ TEST_MAIN("CRC")
 		REQUIRE(crc64(buf, 21) == 0);
 	}
 
+	TEST("Check value") {
+		REQUIRE(crc64((unsigned char *)"123456789", 9) ==
+			0x6c40df5f0b497347);
+		REQUIRE(crc64(NULL, 0) == 0);
+	}
+
+	srand(1);
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = rand();
+
+	TEST("Table-driven word CRC") {
+		for (i = 0; i < 10000; i++) {
+			word = (uint64_t)rand() << 40 ^ (uint64_t)rand() << 20 ^
+				rand();
+
+			REQUIRE(crc64_8h(word) == crc64_8h_bitwise(word));
+		}
+
+		REQUIRE(crc64_8h(0) == 0);
+		REQUIRE(crc64_8h(~0ULL) == crc64_8h_bitwise(~0ULL));
+	}
+
+	TEST("Table-driven stream CRC") {
+		for (i = 0; i < 16; i++)
+			for (j = 0; j < 300; j++)
+				REQUIRE(crc64(data + i, j) ==
+					crc64_bitwise(data + i, j));
+
+		REQUIRE(crc64(data, sizeof(data)) ==
+			crc64_bitwise(data, sizeof(data)));
+	}
+
+	TEST("Table fallback") {
+		for (i = 0; i < 16; i++)
+			for (j = 0; j < sizeof(data) - 16; j += 37)
+				REQUIRE(crc64_update_table(0, data + i, j) ==
+					crc64_bitwise(data + i, j));
+	}
+
+	TEST("Incremental CRC") {
+		for (i = 0; i < 50; i++) {
+			crc = crc64_init();
+
+			for (j = 0; j < sizeof(data); j += word) {
+				word = rand() % 300;
+
+				if (word > sizeof(data) - j)
+					word = sizeof(data) - j;
+
+				crc = crc64_update(crc, data + j, word);
+			}
+
+			REQUIRE(crc64_final(crc) ==
+				crc64_bitwise(data, sizeof(data)));
+		}
+	}
+
+	TEST("Combine CRCs") {
+		for (i = 0; i <= sizeof(data); i += 1 + rand() % 50) {
+			crc = crc64_combine(crc64(data, i),
+					    crc64(data + i, sizeof(data) - i),
+					    sizeof(data) - i);
+
+			REQUIRE(crc == crc64(data, sizeof(data)));
+		}
+
+		REQUIRE(crc64_combine(0x1234, 0, 0) == 0x1234);
+	}
+
+	big = malloc(big_size);
+
+	for (i = 0; i < big_size; i++)
+		big[i] = rand();
+
+	TEST("Parallel CRC") {
+		crc = crc64(big, big_size);
+
+		REQUIRE(crc64_parallel(big, big_size, 3) == crc);
+		REQUIRE(crc64_parallel(big, big_size, 0) == crc);
+		REQUIRE(crc64_parallel(big, big_size, 1000) == crc);
+		REQUIRE(crc64_parallel(data, sizeof(data), 4) ==
+			crc64(data, sizeof(data)));
+	}
+
+	free(big);
+
 	return 0;
 }
 
@@ -0,0 +1,247 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <iconv.h>
+#include <time.h>
+#include <err.h>
+
+#include "../src/stringfunc.h"
+
+#define CORPUS_BYTES (1 << 20)
+#define STRING_BYTES 256
+#define RUNS 20
+
+/**
+ * Get the current time in seconds.
+ **/
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * The escaper as it was before working directly on UTF-8: widen the string
+ * to UTF-32 with iconv, then print each character with sprintf. Kept to
+ * compare against.
+ **/
+static char *
+iconv_escape(const char *in)
+{
+	size_t chars = strlen(in);
+	size_t in_bytes = chars + 1;
+	size_t out_bytes = 4 * (chars + 2);
+	uint32_t *expanded = malloc(out_bytes);
+	char *in_pos = (char *)in;
+	char *out_pos = (char *)expanded;
+	iconv_t ic = iconv_open("UTF-32", "UTF-8");
+	char *ret = malloc(6 * chars + 1);
+	char *pos = ret;
+	size_t i;
+
+	if (! expanded || ! ret || ic == (iconv_t)-1)
+		errx(1, "Setup failed");
+
+	if (iconv(ic, &in_pos, &in_bytes, &out_pos, &out_bytes) == (size_t)-1)
+		errx(1, "Conversion failed");
+
+	iconv_close(ic);
+
+	for (i = 1; expanded[i]; i++) {
+		if (expanded[i] & 0xffffff80) {
+			pos += sprintf(pos, "\\u%04x", expanded[i]);
+			continue;
+		}
+
+		switch (expanded[i]) {
+		case '\"':
+			pos += sprintf(pos, "\\\"");
+			break;
+		case '\\':
+			pos += sprintf(pos, "\\\\");
+			break;
+		case '/':
+			pos += sprintf(pos, "\\/");
+			break;
+		case '\b':
+			pos += sprintf(pos, "\\b");
+			break;
+		case '\f':
+			pos += sprintf(pos, "\\f");
+			break;
+		case '\n':
+			pos += sprintf(pos, "\\n");
+			break;
+		case '\r':
+			pos += sprintf(pos, "\\r");
+			break;
+		case '\t':
+			pos += sprintf(pos, "\\t");
+			break;
+		case '\v':
+			pos += sprintf(pos, "\\v");
+			break;
+		default:
+			if (iscntrl(expanded[i]))
+				pos += sprintf(pos, "\\u%04x", expanded[i]);
+			else
+				pos += sprintf(pos, "%c", (char)expanded[i]);
+		}
+	}
+
+	*pos = '\0';
+	free(expanded);
+	return ret;
+}
+
+/**
+ * Build a corpus of NUL-separated strings of about STRING_BYTES each, drawn
+ * from the given pieces of text.
+ **/
+static char *
+build_corpus(const char **pieces, size_t count)
+{
+	char *ret = malloc(CORPUS_BYTES + STRING_BYTES + 64);
+	const char *piece;
+	size_t pos = 0;
+	size_t line = 0;
+	size_t len;
+
+	if (! ret)
+		errx(1, "Malloc failed");
+
+	while (pos < CORPUS_BYTES) {
+		piece = pieces[rand() % count];
+		len = strlen(piece);
+		memcpy(ret + pos, piece, len);
+		pos += len;
+		line += len;
+
+		if (line >= STRING_BYTES) {
+			ret[pos++] = '\0';
+			line = 0;
+		}
+	}
+
+	ret[pos++] = '\0';
+	ret[pos] = '\0';
+	return ret;
+}
+
+/**
+ * Time escaping each string of a corpus and report throughput.
+ **/
+static void
+bench_escape(const char *name, char *(*escape)(const char *),
+	     const char *corpus)
+{
+	double start = now();
+	double elapsed;
+	const char *str;
+	size_t bytes = 0;
+	int i;
+
+	for (i = 0; i < RUNS; i++) {
+		for (str = corpus; *str; str += strlen(str) + 1) {
+			free(escape(str));
+			bytes += strlen(str);
+		}
+	}
+
+	elapsed = now() - start;
+	printf("%-24s %8.2f MB/s\n", name, bytes / elapsed / 1e6);
+}
+
+/**
+ * Check that both escapers agree on a corpus.
+ **/
+static void
+check_corpus(const char *name, const char *corpus)
+{
+	const char *str;
+	char *a;
+	char *b;
+
+	for (str = corpus; *str; str += strlen(str) + 1) {
+		a = string_escape(str);
+		b = iconv_escape(str);
+
+		if (strcmp(a, b))
+			errx(1, "%s: escapers disagree", name);
+
+		free(a);
+		free(b);
+	}
+}
+
+/**
+ * String escaping throughput benchmarks.
+ **/
+int
+main(void)
+{
+	static const char *ascii[] = {
+		"the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ",
+		"dogs, ", "and ", "then ", "some. ",
+	};
+	static const char *escapes[] = {
+		"path/to/", "\"quoted\" ", "line\n", "tab\there ", "back\\slash ",
+		"word ",
+	};
+	static const char *unicode[] = {
+		"caf\xc3\xa9 ", "\xce\xb1\xce\xb2\xce\xb3 ", "\xe6\x97\xa5\xe6\x9c\xac ",
+		"plain ", "\xe2\x82\xac" "5 ",
+	};
+	struct {
+		const char *name;
+		const char **pieces;
+		size_t count;
+	} corpora[] = {
+		{ "ascii", ascii, sizeof(ascii) / sizeof(ascii[0]) },
+		{ "escapes", escapes, sizeof(escapes) / sizeof(escapes[0]) },
+		{ "unicode", unicode, sizeof(unicode) / sizeof(unicode[0]) },
+	};
+	char name[64];
+	char *corpus;
+	size_t i;
+
+	srand(1);
+
+	for (i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++) {
+		corpus = build_corpus(corpora[i].pieces, corpora[i].count);
+		check_corpus(corpora[i].name, corpus);
+
+		snprintf(name, sizeof(name), "%s (iconv)", corpora[i].name);
+		bench_escape(name, iconv_escape, corpus);
+		snprintf(name, sizeof(name), "%s (utf-8)", corpora[i].name);
+		bench_escape(name, string_escape, corpus);
+
+		free(corpus);
+	}
+
+	return 0;
+}
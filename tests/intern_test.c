@@ -0,0 +1,110 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/intern.h"
+#include "harness.h"
+
+#define MANY_STRINGS 5000
+
+TESTS(4);
+
+/**
+ * Exercise the string intern pool.
+ **/
+TEST_MAIN("Intern pool")
+{
+	struct interned *many[MANY_STRINGS];
+	struct interned *a;
+	struct interned *b;
+	char buf[32];
+	size_t i;
+
+	TEST("Intern equal strings") {
+		a = intern("name", 4);
+		b = intern("name and more", 4);
+
+		REQUIRE(a == b);
+		REQUIRE(a->refcount == 2);
+		REQUIRE(a->length == 4);
+		REQUIRE(! strcmp(a->text, "name"));
+
+		intern_release(a);
+		intern_release(b);
+	}
+
+	TEST("Intern different strings") {
+		a = intern("a\0b", 3);
+		b = intern("a\0c", 3);
+
+		REQUIRE(a != b);
+		REQUIRE(a->length == 3);
+		REQUIRE(! memcmp(a->text, "a\0b", 4));
+		REQUIRE(b == intern_ref(b));
+
+		intern_release(a);
+		intern_release(b);
+		intern_release(b);
+	}
+
+	TEST("Intern many strings") {
+		for (i = 0; i < MANY_STRINGS; i++) {
+			sprintf(buf, "key %zu", i);
+			many[i] = intern(buf, strlen(buf));
+		}
+
+		for (i = 0; i < MANY_STRINGS; i++) {
+			sprintf(buf, "key %zu", i);
+			a = intern(buf, strlen(buf));
+
+			REQUIRE(a == many[i]);
+			REQUIRE(a->refcount == 2);
+
+			intern_release(a);
+		}
+	}
+
+	TEST("Release strings") {
+		/* Releasing every other string leaves gaps in the probe
+		 * sequences of the rest. */
+		for (i = 0; i < MANY_STRINGS; i += 2)
+			intern_release(many[i]);
+
+		for (i = 1; i < MANY_STRINGS; i += 2) {
+			sprintf(buf, "key %zu", i);
+			a = intern(buf, strlen(buf));
+
+			REQUIRE(a == many[i]);
+			REQUIRE(a->refcount == 2);
+
+			intern_release(a);
+			intern_release(a);
+		}
+
+		a = intern("key 0", 5);
+		REQUIRE(a->refcount == 1);
+		intern_release(a);
+	}
+
+	return 0;
+}
@@ -28,7 +28,7 @@
 
 #include "harness.h"
 
-TESTS(14);
+TESTS(17);
 
 /**
  * Basic exercise of namespaces.
@@ -42,6 +42,7 @@ TEST_MAIN("Namespaces")
 	ason_ns_t *root;
 	ason_ns_t *sub_1 = NULL;
 	ason_ns_t *sub_2 = NULL;
+	ason_tpl_t *tpl = NULL;
 
 	a = ason_read("{ \"foo\": 6, \"bar\": 7, \"baz\": 8 }");
 
@@ -220,6 +221,83 @@ TEST_MAIN("Namespaces")
 	ason_ns_destroy(root);
 	ason_ns_destroy(sub_2);
 
+	root = ason_ns_create(ASON_NS_RAM, NULL);
+	sub_1 = ason_ns_create(ASON_NS_RAM, NULL);
+	ason_ns_attach(sub_1, root, "sub_1");
+
+	a = ason_read("6");
+	b = NULL;
+	c = ason_read("6 | 7");
+	d = NULL;
+	ason_ns_mkvar(root, "sub_1.x");
+	ason_ns_store(root, "sub_1.x", a);
+
+	TEST("Read symbols") {
+		b = ason_ns_read(root, "sub_1.x | 7 | sub_1.x");
+		REQUIRE(ason_check_equal(b, c));
+		ason_destroy(b);
+
+		b = ason_ns_read(root, "sub_1.y | sub_1.x");
+		REQUIRE(ason_check_equal(b, a));
+		ason_destroy(b);
+
+		b = ason_ns_read(root, "sub_1.y := sub_1.x | 7");
+		REQUIRE(ason_check_equal(b, c));
+
+		d = ason_ns_load(root, "sub_1.y");
+		REQUIRE(ason_check_equal(d, c));
+	}
+
+	ason_destroy(b);
+	ason_destroy(d);
+	b = d = NULL;
+
+	TEST("Read symbols from a template") {
+		tpl = ason_ns_prepare(root, "sub_1.x | ?i | sub_1.x");
+		REQUIRE(tpl);
+
+		b = ason_bind_exec(tpl, 7);
+		REQUIRE(ason_check_equal(b, c));
+
+		ason_destroy(a);
+		a = ason_read("8");
+		ason_ns_store(root, "sub_1.x", a);
+		ason_destroy(c);
+		c = ason_read("8 | 7");
+
+		d = ason_bind_exec(tpl, 7);
+		REQUIRE(ason_check_equal(d, c));
+	}
+
+	if (tpl)
+		ason_tpl_destroy(tpl);
+
+	ason_destroy(b);
+	ason_destroy(d);
+	b = d = NULL;
+	tpl = NULL;
+
+	TEST("Assign from a template") {
+		tpl = ason_ns_prepare(root, "sub_1.z := ?i");
+		REQUIRE(tpl);
+		REQUIRE(! ason_ns_load(root, "sub_1.z"));
+
+		b = ason_bind_exec(tpl, 7);
+		d = ason_ns_load(root, "sub_1.z");
+		REQUIRE(d);
+		REQUIRE(! ason_check_equal(d, ASON_EMPTY));
+		REQUIRE(ason_check_equal(d, b));
+	}
+
+	if (tpl)
+		ason_tpl_destroy(tpl);
+
+	ason_destroy(a);
+	ason_destroy(b);
+	ason_destroy(c);
+	ason_destroy(d);
+	ason_ns_destroy(root);
+
 	TEST("Register bad protocol name") {
 		REQUIRE(ason_ns_register_proto(NULL, "") == -EINVAL);
 	}
@@ -0,0 +1,405 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <err.h>
+
+#include <ason/ason.h>
+#include <ason/read.h>
+#include <ason/print.h>
+
+#define CORPUS_ITEMS 100000
+#define LIST_ITEMS 10
+#define RUNS 10
+#define TEMPLATE_RUNS 200000
+#define UNION_ITEMS 20000
+#define MATCH_ITEMS 5000
+#define MATCH_QUERIES 1000
+#define MATCH_RUNS 200
+#define TEMPLATE "{ \"id\": ?i, \"name\": ?s, \"tags\": [ ?s, ?s ], \"score\": ?f }"
+
+/**
+ * Get the current time in seconds.
+ **/
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Build a corpus of short lists of numbers in a mix of the forms JSON allows,
+ * one list per line.
+ **/
+static char *
+number_corpus(size_t *length)
+{
+	size_t size = CORPUS_ITEMS * 32;
+	char *ret = malloc(size);
+	size_t pos = 0;
+	size_t i;
+
+	if (! ret)
+		errx(1, "Malloc failed");
+
+	for (i = 0; i < CORPUS_ITEMS; i++) {
+		if (i % LIST_ITEMS)
+			ret[pos++] = ',';
+		else
+			ret[pos++] = '[';
+
+		switch (i % 4) {
+		case 0:
+			pos += sprintf(ret + pos, "%d", rand() % 100000);
+			break;
+		case 1:
+			pos += sprintf(ret + pos, "-%d.%06d", rand() % 1000,
+				       rand() % 1000000);
+			break;
+		case 2:
+			pos += sprintf(ret + pos, "%d.%d", rand() % 100000000,
+				       rand() % 100);
+			break;
+		default:
+			pos += sprintf(ret + pos, "%d.%de-%d", rand() % 10,
+				       rand() % 1000, rand() % 5);
+		}
+
+		if (i % LIST_ITEMS == LIST_ITEMS - 1) {
+			ret[pos++] = ']';
+			ret[pos++] = '\n';
+		}
+	}
+
+	ret[pos] = '\0';
+	*length = pos;
+	return ret;
+}
+
+/**
+ * Build a corpus of small JSON objects, one per line.
+ **/
+static char *
+json_corpus(size_t *length)
+{
+	size_t size = CORPUS_ITEMS * 160;
+	char *ret = malloc(size);
+	size_t pos = 0;
+	size_t i;
+
+	if (! ret)
+		errx(1, "Malloc failed");
+
+	for (i = 0; i < CORPUS_ITEMS; i++)
+		pos += sprintf(ret + pos, "{\"id\": %zu, \"name\": \"user %d\", "
+			       "\"active\": %s, \"score\": %d.%02d, "
+			       "\"tags\": [\"a\", \"b\\n\"], \"next\": null}\n",
+			       i, rand() % 100000, rand() % 2 ? "true" : "false",
+			       rand() % 100, rand() % 100);
+
+	*length = pos;
+	return ret;
+}
+
+/**
+ * Build one long union of distinct numbers.
+ **/
+static char *
+union_corpus(size_t *length)
+{
+	char *ret = malloc(UNION_ITEMS * 12);
+	size_t pos = 0;
+	size_t i;
+
+	if (! ret)
+		errx(1, "Malloc failed");
+
+	for (i = 0; i < UNION_ITEMS; i++)
+		pos += sprintf(ret + pos, "%s%zu", i ? " | " : "", i * 2);
+
+	ret[pos++] = '\n';
+	ret[pos] = '\0';
+	*length = pos;
+	return ret;
+}
+
+/**
+ * Build one long union of distinct strings.
+ **/
+static char *
+string_union_corpus(void)
+{
+	char *ret = malloc(MATCH_ITEMS * 40);
+	size_t pos = 0;
+	size_t i;
+
+	if (! ret)
+		errx(1, "Malloc failed");
+
+	for (i = 0; i < MATCH_ITEMS; i++)
+		pos += sprintf(ret + pos, "%s\"/api/v1/resource/%zu\"",
+			       i ? " | " : "", i * 7);
+
+	return ret;
+}
+
+/**
+ * Join the lines of a corpus into a single list.
+ **/
+static char *
+single_list(const char *corpus, size_t *length)
+{
+	char *ret = malloc(*length + 3);
+	size_t pos = 0;
+	const char *c;
+
+	if (! ret)
+		errx(1, "Malloc failed");
+
+	ret[pos++] = '[';
+
+	for (c = corpus; *c; c++) {
+		if (*c == '[' || *c == ']')
+			continue;
+
+		ret[pos++] = *c == '\n' ? ',' : *c;
+	}
+
+	ret[pos - 1] = ']';
+	ret[pos++] = '\n';
+	ret[pos] = '\0';
+	*length = pos;
+	return ret;
+}
+
+/**
+ * Read ASON with no format arguments.
+ **/
+static ason_t *
+read_ason(const char *text, size_t length)
+{
+	return ason_readn(text, length);
+}
+
+/**
+ * Read a list on one thread per CPU.
+ **/
+static ason_t *
+read_parallel(const char *text, size_t length)
+{
+	return ason_readn_parallel(text, length, 0);
+}
+
+/**
+ * Time repeated parses of a corpus of one document per line and report
+ * throughput.
+ **/
+static void
+bench_read(const char *name, ason_t *(*read)(const char *, size_t),
+	   const char *text, size_t length, size_t items)
+{
+	double start = now();
+	double elapsed;
+	const char *line;
+	const char *end;
+	ason_t *value;
+	int i;
+
+	for (i = 0; i < RUNS; i++) {
+		for (line = text; *line; line = end + 1) {
+			end = strchr(line, '\n');
+			value = read(line, end - line);
+
+			if (! value)
+				errx(1, "%s: corpus did not parse", name);
+
+			ason_destroy(value);
+		}
+	}
+
+	elapsed = now() - start;
+
+	printf("%-16s %8.2f MB/s %12.0f items/s\n", name,
+	       length * RUNS / elapsed / 1e6, items * RUNS / elapsed);
+}
+
+/**
+ * Time printing a value.
+ **/
+static void
+bench_print(const char *name, const char *text, size_t items)
+{
+	ason_t *value = ason_read(text);
+	double start;
+	double elapsed;
+	char *out;
+	int i;
+
+	if (! value)
+		errx(1, "%s: corpus did not parse", name);
+
+	start = now();
+
+	for (i = 0; i < RUNS; i++) {
+		out = ason_asprint(value);
+		free(out);
+	}
+
+	elapsed = now() - start;
+	printf("%-16s %8.0f items/s\n", name, items * RUNS / elapsed);
+
+	ason_destroy(value);
+}
+
+/**
+ * Time matching single strings, half of which are present, against a long
+ * union of strings.
+ **/
+static void
+bench_match(void)
+{
+	char *text = string_union_corpus();
+	ason_t *set = ason_read(text);
+	ason_t *queries[MATCH_QUERIES];
+	double start;
+	double elapsed;
+	size_t matched = 0;
+	char query[40];
+	int i, j;
+
+	if (! set)
+		errx(1, "string union did not parse");
+
+	for (i = 0; i < MATCH_QUERIES; i++) {
+		sprintf(query, "\"/api/v1/resource/%d\"", i * 7 + (i % 2));
+		queries[i] = ason_read(query);
+	}
+
+	start = now();
+
+	for (j = 0; j < MATCH_RUNS; j++)
+		for (i = 0; i < MATCH_QUERIES; i++)
+			matched += ason_check_represented_in(queries[i], set);
+
+	elapsed = now() - start;
+
+	if (matched != MATCH_RUNS * MATCH_QUERIES / 2)
+		errx(1, "string match gave the wrong answer");
+
+	printf("%-16s %8.0f matches/s\n", "string match",
+	       MATCH_RUNS * MATCH_QUERIES / elapsed);
+
+	for (i = 0; i < MATCH_QUERIES; i++)
+		ason_destroy(queries[i]);
+
+	ason_destroy(set);
+	free(text);
+}
+
+/**
+ * Time filling in the same format string repeatedly, both by reading it each
+ * time and by executing a compiled template.
+ **/
+static void
+bench_template(void)
+{
+	ason_tpl_t *tpl = ason_prepare(TEMPLATE);
+	ason_t *value;
+	double start;
+	double elapsed;
+	int i;
+
+	if (! tpl)
+		errx(1, "template did not compile");
+
+	start = now();
+
+	for (i = 0; i < TEMPLATE_RUNS; i++) {
+		value = ason_read(TEMPLATE, i, "name", "a", "b", i / 3.0);
+
+		if (! value)
+			errx(1, "template did not parse");
+
+		ason_destroy(value);
+	}
+
+	elapsed = now() - start;
+	printf("%-16s %8.0f execs/s\n", "format read", TEMPLATE_RUNS / elapsed);
+
+	start = now();
+
+	for (i = 0; i < TEMPLATE_RUNS; i++) {
+		value = ason_bind_exec(tpl, i, "name", "a", "b", i / 3.0);
+
+		if (! value)
+			errx(1, "template did not execute");
+
+		ason_destroy(value);
+	}
+
+	elapsed = now() - start;
+	printf("%-16s %8.0f execs/s\n", "template", TEMPLATE_RUNS / elapsed);
+
+	ason_tpl_destroy(tpl);
+}
+
+/**
+ * Parser throughput benchmarks.
+ **/
+int
+main(void)
+{
+	size_t length;
+	char *text;
+	char *list;
+
+	srand(1);
+
+	text = number_corpus(&length);
+	bench_read("numbers", read_ason, text, length, CORPUS_ITEMS);
+
+	list = single_list(text, &length);
+	bench_read("long list", read_ason, list, length, CORPUS_ITEMS);
+	bench_read("long list (par)", read_parallel, list, length,
+		   CORPUS_ITEMS);
+	free(list);
+	free(text);
+
+	text = json_corpus(&length);
+	bench_read("json (ason)", read_ason, text, length, CORPUS_ITEMS);
+	bench_read("json (json)", ason_readn_json, text, length, CORPUS_ITEMS);
+	bench_read("json (lazy)", ason_readn_lazy, text, length, CORPUS_ITEMS);
+	free(text);
+
+	text = union_corpus(&length);
+	bench_read("long union", read_ason, text, length, UNION_ITEMS);
+	bench_print("print union", text, UNION_ITEMS);
+	free(text);
+
+	bench_match();
+	bench_template();
+
+	return 0;
+}
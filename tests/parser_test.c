@@ -19,6 +19,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
 
 #include <ason/ason.h>
 #include <ason/print.h>
@@ -27,7 +31,36 @@
 
 #include "harness.h"
 
-TESTS(24);
+TESTS(40);
+
+/**
+ * Build a list of `count` elements long enough to be read in parallel, with
+ * element `at` replaced by `element`.
+ **/
+static char *
+parallel_list(size_t count, size_t at, const char *element, size_t *length)
+{
+	char *str = malloc(count * 32 + strlen(element) + 3);
+	size_t i;
+
+	*length = sprintf(str, "[");
+
+	for (i = 0; i < count; i++) {
+		if (i)
+			*length += sprintf(str + *length, ", ");
+
+		if (i == at)
+			*length += sprintf(str + *length, "%s", element);
+		else
+			*length += sprintf(str + *length,
+					   "%zu, \"a,]\", [%zu, {\"x\": 1}]",
+					   i, i);
+	}
+
+	*length += sprintf(str + *length, "]");
+
+	return str;
+}
 
 /**
  * Basic exercise of the parser.
@@ -40,6 +73,10 @@ TEST_MAIN("Parse values")
 	ason_t *c = NULL;
 	char *str = NULL;
 	ason_iter_t *iter;
+	ason_tpl_t *tpl;
+	char *c_str;
+	size_t length;
+	size_t i;
 
 	TEST("Parse parameter") {
 		a = ason_read("?i", 7);
@@ -86,6 +123,70 @@ TEST_MAIN("Parse values")
 
 	ason_destroy(a);
 
+	a = NULL;
+	b = NULL;
+
+	TEST("Round float parameters") {
+		static const char *text[] = {
+			"0.1", "-0.1", "0.00002288818359375",
+			"0.00003814697265625", "-0.00003814697265625",
+		};
+		static const double value[] = {
+			0.1, -0.1, 0.00002288818359375, 0.00003814697265625,
+			-0.00003814697265625,
+		};
+
+		for (i = 0; i < sizeof(text) / sizeof(*text); i++) {
+			a = ason_read("?F", value[i]);
+			b = ason_read(text[i]);
+			REQUIRE(ason_check_equal(a, b));
+			ason_destroy(a);
+			ason_destroy(b);
+			a = b = NULL;
+		}
+	}
+
+	ason_destroy(a);
+	ason_destroy(b);
+
+	a = NULL;
+	str = NULL;
+	tpl = NULL;
+
+	TEST("Out of range parameters") {
+		a = ason_read("?I", (int64_t)140737488355327);
+		REQUIRE(a);
+		str = ason_asprint(a);
+		REQUIRE(! strcmp(str, "140737488355327"));
+		ason_destroy(a);
+		free(str);
+
+		a = ason_read("?I", (int64_t)-140737488355328);
+		REQUIRE(a);
+		str = ason_asprint(a);
+		REQUIRE(! strcmp(str, "-140737488355328"));
+
+		REQUIRE(! ason_read("?I", (int64_t)140737488355328));
+		REQUIRE(! ason_read("?I", (int64_t)-140737488355329));
+		REQUIRE(! ason_read("?I", INT64_MAX));
+		REQUIRE(! ason_read("?U", (uint64_t)140737488355328));
+		REQUIRE(! ason_read("?U", UINT64_MAX));
+		REQUIRE(! ason_read("?f", 140737488355328.0));
+		REQUIRE(! ason_read("?f", 1e300));
+		REQUIRE(! ason_read("?f", (double)NAN));
+		REQUIRE(! ason_read("[?i, ?I]", 1, INT64_MIN));
+
+		tpl = ason_prepare("?i | ?U");
+		REQUIRE(tpl);
+		REQUIRE(! ason_bind_exec(tpl, 1, (uint64_t)1 << 50));
+	}
+
+	ason_destroy(a);
+	free(str);
+
+	if (tpl)
+		ason_tpl_destroy(tpl);
+
 	TEST("Parse string parameter") {
 		a = ason_read("?s", "foo");
 		str = ason_string(a);
@@ -234,6 +335,52 @@ TEST_MAIN("Parse values")
 	free(str);
 	str = NULL;
 
+	a = ason_read("15.25");
+
+	TEST("Number exponent") {
+		test_value = ason_read("1525e-2");
+		REQUIRE(ason_check_equal(test_value, a));
+		ason_destroy(test_value);
+
+		test_value = ason_read("0.1525E+2");
+		REQUIRE(ason_check_equal(test_value, a));
+	}
+
+	ason_destroy(test_value);
+	ason_destroy(a);
+
+	TEST("Number overflow") {
+		REQUIRE(! ason_read("1e100"));
+		REQUIRE(! ason_read("-99999999999999999999"));
+	}
+
+	TEST("Operator simplification") {
+		a = ason_read("!(!(1 | 2))");
+		b = ason_read("1 | 2");
+		REQUIRE(ason_check_equal(a, b));
+		ason_destroy(a);
+
+		a = ason_read("(1 | _ | 2) & (U & U)");
+		REQUIRE(ason_check_equal(a, b));
+		ason_destroy(a);
+		ason_destroy(b);
+
+		a = ason_read("1 | (2 | U) | 3");
+		REQUIRE(ason_check_equal(a, ASON_UNIVERSE));
+		ason_destroy(a);
+
+		a = ason_read("1 & !U & 3");
+		REQUIRE(ason_check_equal(a, ASON_EMPTY));
+		ason_destroy(a);
+
+		a = ason_read("1 | 2 | 3 | 4 | 5 | 6 | 7 | 8 | 9");
+		b = ason_read("(9 | 7 | 5) | (3 | 1) | (2 | 4) | (6 | 8)");
+		REQUIRE(ason_check_equal(a, b));
+	}
+
+	ason_destroy(a);
+	ason_destroy(b);
+
 	TEST("Equivalence (true)") {
 		test_value = ason_read("1 = 1");
 
@@ -293,6 +440,255 @@ TEST_MAIN("Parse values")
 	ason_destroy(a);
 	ason_destroy(b);
 
+	a = NULL;
+	b = ason_read("6 | 7");
+
+	TEST("Read from file") {
+		char path[] = "/tmp/ason_parser_test.XXXXXX";
+		int fd = mkstemp(path);
+
+		REQUIRE(fd >= 0);
+		REQUIRE(write(fd, "6 | 7", 5) == 5);
+		close(fd);
+
+		a = ason_read_file(path);
+		unlink(path);
+		REQUIRE(ason_check_equal(a, b));
+	}
+
+	ason_destroy(a);
+	ason_destroy(b);
+
+	a = NULL;
+	b = NULL;
+	c = ason_read("6.5 | -7");
+	tpl = NULL;
+
+	TEST("Prepared template") {
+		tpl = ason_prepare("?f | ?I");
+		REQUIRE(tpl);
+
+		a = ason_bind_exec(tpl, 6.5, (int64_t)-7);
+		REQUIRE(ason_check_equal(a, c));
+
+		b = ason_bind_exec(tpl, 1.0, (int64_t)2);
+		ason_destroy(c);
+		c = ason_read("1 | 2");
+		REQUIRE(ason_check_equal(b, c));
+	}
+
+	ason_destroy(a);
+	ason_destroy(b);
+	ason_destroy(c);
+
+	if (tpl)
+		ason_tpl_destroy(tpl);
+
+	tpl = NULL;
+
+	TEST("Prepared template (syntax error)") {
+		REQUIRE(! ason_prepare("?i % 2"));
+		REQUIRE(! ason_prepare("?i | | 2"));
+		REQUIRE(! ason_prepare("[?s, "));
+		REQUIRE(! ason_prepare("{?i: 1}"));
+	}
+
+	a = NULL;
+	b = NULL;
+	c = ason_read("\"lit\" | \"x\" | 1");
+
+	TEST("Prepared template (strings)") {
+		tpl = ason_prepare("{?s: \"lit\"} | \"lit\" | ?s | ?i");
+		REQUIRE(tpl);
+
+		a = ason_bind_exec(tpl, "k", "x", 1);
+		b = ason_bind_exec(tpl, "k", "x", 1);
+		REQUIRE(a);
+		REQUIRE(ason_check_equal(a, c));
+		REQUIRE(ason_check_equal(b, c));
+	}
+
+	ason_destroy(a);
+	ason_destroy(b);
+	ason_destroy(c);
+
+	if (tpl)
+		ason_tpl_destroy(tpl);
+
+	a = NULL;
+	b = ason_read("-6.25");
+
+	TEST("Read JSON") {
+		a = ason_read_json(" -625e-2 ");
+		REQUIRE(ason_check_equal(a, b));
+		ason_destroy(a);
+
+		a = ason_read_json("{\"a\": [1, 2.5, \"x\\u00e9\"], \"b\": {}}");
+		REQUIRE(a);
+		ason_destroy(a);
+
+		a = ason_read_json("[true, false, null, []]");
+		REQUIRE(a);
+	}
+
+	ason_destroy(a);
+	ason_destroy(b);
+
+	TEST("Read JSON (invalid)") {
+		REQUIRE(! ason_read_json("1 | 2"));
+		REQUIRE(! ason_read_json("[1, 2,]"));
+		REQUIRE(! ason_read_json("{\"a\" 1}"));
+		REQUIRE(! ason_read_json("{\"a\": 1,}"));
+		REQUIRE(! ason_read_json("\"\\v\""));
+		REQUIRE(! ason_read_json("\"tab\there\""));
+		REQUIRE(! ason_read_json("tru"));
+		REQUIRE(! ason_read_json("01"));
+		REQUIRE(! ason_read_json("[1] 2"));
+		REQUIRE(! ason_read_json(""));
+	}
+
+	a = NULL;
+	b = NULL;
+
+	TEST("Read lazily") {
+		a = ason_read_lazy(" \"a\\u0041\\ud83d\\ude00\" ");
+		b = ason_read("\"aA😀\"");
+		REQUIRE(a);
+		REQUIRE(! ason_check_equal(a, ASON_EMPTY));
+		REQUIRE(ason_check_equal(a, b));
+		ason_destroy(a);
+		ason_destroy(b);
+
+		a = ason_read_lazy(" -6.25 ");
+		b = ason_read("-6.25");
+		REQUIRE(a);
+		REQUIRE(! ason_check_equal(a, ASON_EMPTY));
+		REQUIRE(ason_check_equal(a, b));
+		ason_destroy(b);
+
+		b = ason_read("-6.5");
+		REQUIRE(! ason_check_equal(a, b));
+		ason_destroy(a);
+		ason_destroy(b);
+
+		a = ason_read_lazy("[1, {\"a\": [2, \"]\\\"}\"]}, 3]");
+		REQUIRE(a);
+	}
+
+	ason_destroy(a);
+	a = NULL;
+	b = NULL;
+
+	TEST("Read lazily (invalid)") {
+		static const char *invalid[] = {
+			"[1, 2", "[1, \"]\"", "[1] 2", "1 | 2", "[1, x]",
+			"[[1, 2], {\"a\" 1}]", "{\"a\": [1, 2,]}", "[01]",
+			"[\"\\uzzzz\"]", "[\"\\ud800\"]", "[\"\\v\"]", "[tru]",
+			"[\"tab\there\"]", "[\"a\\u0000b\"]",
+		};
+
+		for (i = 0; i < sizeof(invalid) / sizeof(*invalid); i++) {
+			REQUIRE(! ason_read_json(invalid[i]));
+			REQUIRE(! ason_read_lazy(invalid[i]));
+		}
+	}
+
+	str = parallel_list(20000, 20000, "", &length);
+
+	TEST("Read in parallel") {
+		static const char *tricky[] = {
+			"\"\\\",[\"", "(\"x\" | [\"]\", {\"y,\": (1)}])",
+			"\"\\\\\"", "[[[\"}\"]], {}]",
+		};
+		size_t j;
+		char *list;
+		size_t list_length;
+
+		a = ason_readn_parallel(str, length, 4);
+		b = ason_readn(str, length);
+		REQUIRE(a);
+		REQUIRE(b);
+		REQUIRE(ason_check_equal(a, b));
+		ason_destroy(a);
+		ason_destroy(b);
+
+		for (i = 0; i < sizeof(tricky) / sizeof(*tricky); i++) {
+			for (j = 0; j < 20000; j += 9999) {
+				list = parallel_list(20000, j, tricky[i],
+						     &list_length);
+				a = ason_readn(list, list_length);
+				b = ason_readn_parallel(list, list_length, 4);
+				free(list);
+
+				REQUIRE(a);
+				REQUIRE(b);
+				REQUIRE(ason_check_equal(a, b));
+				ason_destroy(a);
+				ason_destroy(b);
+			}
+		}
+
+		a = ason_readn_parallel("[ ]", 3, 4);
+		b = ason_read("[]");
+		REQUIRE(a);
+		REQUIRE(ason_check_equal(a, b));
+
+		ason_destroy(a);
+		ason_destroy(b);
+
+		a = ason_readn_parallel("1 | 2", 5, 4);
+		b = ason_read("1 | 2");
+		REQUIRE(a);
+		REQUIRE(ason_check_equal(a, b));
+	}
+
+	ason_destroy(a);
+	ason_destroy(b);
+
+	TEST("Read in parallel (element grammar)") {
+		static const char *invalid[] = { "1 = 1", "1 in 2", "1 ⊆ 2" };
+		size_t at[] = { 0, 10000, 19999 };
+		size_t j;
+		char *list;
+		size_t list_length;
+
+		for (i = 0; i < sizeof(invalid) / sizeof(*invalid); i++) {
+			for (j = 0; j < sizeof(at) / sizeof(*at); j++) {
+				list = parallel_list(20000, at[j], invalid[i],
+						     &list_length);
+
+				REQUIRE(list_length >= 65536);
+				REQUIRE(! ason_readn(list, list_length));
+				REQUIRE(! ason_readn_parallel(list, list_length,
+							      4));
+				free(list);
+			}
+		}
+
+		list = parallel_list(20000, 10000, "(1 = 1)", &list_length);
+		a = ason_readn(list, list_length);
+		b = ason_readn_parallel(list, list_length, 4);
+		free(list);
+
+		REQUIRE(a);
+		REQUIRE(b);
+	}
+
+	ason_destroy(a);
+	ason_destroy(b);
+
+	TEST("Read in parallel (invalid)") {
+		c_str = strchr(str + length / 2, ':');
+		*c_str = ',';
+		REQUIRE(! ason_readn_parallel(str, length, 4));
+
+		*c_str = ':';
+		REQUIRE(! ason_readn_parallel(str, length - 1, 4));
+		REQUIRE(! ason_readn_parallel("[?i]", 4, 4));
+	}
+
+	free(str);
+
 	TEST("Empty list") {
 		a = ason_read("[]");
 		iter = ason_iterate(a);
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <ason/ason.h>
 #include <ason/print.h>
@@ -28,7 +29,7 @@
 
 #include "harness.h"
 
-TESTS(21);
+TESTS(32);
 
 static void
 strip_spaces(char *str)
@@ -49,7 +50,15 @@ strip_spaces(char *str)
 TEST_MAIN("Object printing")
 {
 	ason_t *test = NULL;
+	ason_t *expect = NULL;
 	char *output = NULL;
+	ason_buffer_t buf = ASON_BUFFER_INIT;
+	char input[512];
+	char streamed[512];
+	FILE *file;
+	int fds[2];
+	size_t len;
+	size_t i;
 
 #define TEST_OUTPUT(_name, _str) \
 	TEST(_name) { \
@@ -74,6 +83,8 @@ TEST_MAIN("Object printing")
 
 	TEST_OUTPUT("Integer", "6");
 	TEST_OUTPUT("String", "\"foo\"");
+	TEST_OUTPUT("String union", "\"bar\"|\"foo\"");
+	TEST_OUTPUT("Mixed union", "true|\"foo\"|6");
 	TEST_OUTPUT("Null", "null");
 	TEST_OUTPUT("Universe", "U");
 	TEST_OUTPUT("Wild", "*");
@@ -85,6 +96,7 @@ TEST_MAIN("Object printing")
 	TEST_OUTPUT("Universal Object", "{\"bar\":6,\"foo\":7,*}");
 	TEST_OUTPUT("List", "[6,7,8]");
 	TEST_OUTPUT("Union", "6|7");
+	TEST_OUTPUT("Fractions", "-3.25|-0.00002|0.1|2.5|1234567.00002");
 	TEST_OUTPUT_U("Union (Unicode)", "6∪7");
 	TEST_OUTPUT("Empty Universal Object", "{*}");
 	TEST_OUTPUT("Empty Object", "{}");
@@ -110,5 +122,155 @@ TEST_MAIN("Object printing")
 	free(output);
 	ason_destroy(test);
 
+	TEST("Fraction round trip") {
+		for (i = 0; i < 65536; i++) {
+			expect = ason_read("?F", i / 65536.0 - 3);
+			output = ason_asprint(expect);
+			test = ason_read(output);
+			free(output);
+
+			REQUIRE(ason_check_equal(test, expect));
+			ason_destroy(test);
+			ason_destroy(expect);
+		}
+	}
+
+	TEST("JSON output") {
+		test = ason_read_lazy("\"a\\u0041\\n\\/\"");
+		REQUIRE(test);
+
+		output = ason_print_json(test, ASON_JSON_COMPACT);
+		REQUIRE(!strcmp(output, "\"aA\\n/\""));
+		free(output);
+
+		output = ason_print_json(test, ASON_JSON_PRETTY |
+					 ASON_JSON_CANONICAL);
+		REQUIRE(!strcmp(output, "\"aA\\n/\""));
+		free(output);
+		ason_destroy(test);
+
+		test = ason_read("2.50");
+		output = ason_print_json(test, ASON_JSON_CANONICAL);
+		REQUIRE(!strcmp(output, "2.5"));
+		free(output);
+		ason_destroy(test);
+
+		test = ason_read("2.5");
+		output = ason_print_json(test, ASON_JSON_COMPACT);
+		REQUIRE(!strcmp(output, "2.5"));
+		free(output);
+		ason_destroy(test);
+
+		output = ason_print_json(ASON_NULL, ASON_JSON_COMPACT);
+		REQUIRE(!strcmp(output, "null"));
+		free(output);
+		output = NULL;
+	}
+
+	TEST("JSON output (no JSON form)") {
+		test = ason_read("1 | 2");
+		REQUIRE(! ason_print_json(test, ASON_JSON_COMPACT));
+		ason_destroy(test);
+
+		test = ason_read_lazy("[1, 2]");
+		REQUIRE(! ason_print_json(test, ASON_JSON_COMPACT));
+		output = ason_asprint(test);
+		REQUIRE(! ason_print_json(test, ASON_JSON_COMPACT));
+		free(output);
+		output = NULL;
+	}
+
+	ason_destroy(test);
+
+	TEST("Print to fixed buffer") {
+		test = ason_read("6 | 7");
+		strcpy(input, "xxxxxxxx");
+
+		REQUIRE(ason_snprint(NULL, 0, test, 0) == 5);
+		REQUIRE(ason_snprint(input, 0, test, 0) == 5);
+		REQUIRE(!strcmp(input, "xxxxxxxx"));
+		REQUIRE(ason_snprint(input, 4, test, 0) == 5);
+		REQUIRE(!strcmp(input, "6 |"));
+		REQUIRE(ason_snprint(input, 6, test, 0) == 5);
+		REQUIRE(!strcmp(input, "6 | 7"));
+		REQUIRE(ason_snprint(input, sizeof(input), test,
+				     ASON_PRINT_UNICODE) == strlen("6 ∪ 7"));
+		REQUIRE(!strcmp(input, "6 ∪ 7"));
+	}
+
+	ason_destroy(test);
+
+	TEST("Print string to fixed buffer") {
+		test = ason_read("\"a\\\"b©\"");
+		strcpy(input, "xxxxxxxx");
+
+		REQUIRE(ason_snprint(NULL, 0, test, 0) == 12);
+		REQUIRE(ason_snprint(input, 0, test, 0) == 12);
+		REQUIRE(!strcmp(input, "xxxxxxxx"));
+		REQUIRE(ason_snprint(input, 5, test, 0) == 12);
+		REQUIRE(!strcmp(input, "\"a\\\""));
+		REQUIRE(ason_snprint(input, 9, test, 0) == 12);
+		REQUIRE(!strcmp(input, "\"a\\\"b\\u0"));
+		REQUIRE(ason_snprint(input, 13, test, 0) == 12);
+		REQUIRE(!strcmp(input, "\"a\\\"b\\u00a9\""));
+	}
+
+	ason_destroy(test);
+
+	TEST("Print to buffer") {
+		test = ason_read("6 | 7");
+		buf.data = strdup("x = ");
+		buf.length = buf.size = 4;
+
+		len = ason_print_to_buffer(&buf, test, 0);
+		REQUIRE(len == 5);
+		REQUIRE(buf.length == 9);
+		REQUIRE(!strcmp(buf.data, "x = 6 | 7"));
+
+		len = ason_print_to_buffer(&buf, test, ASON_PRINT_UNICODE);
+		REQUIRE(len == strlen("6 ∪ 7"));
+		REQUIRE(!strcmp(buf.data, "x = 6 | 76 ∪ 7"));
+	}
+
+	free(buf.data);
+	ason_destroy(test);
+
+	for (i = 0, len = 0; i < 64; i++)
+		len += sprintf(input + len, "%s%zu", i ? "|" : "", i * 2);
+
+	TEST("Long union") {
+		test = ason_read(input);
+		output = ason_asprint(test);
+		strip_spaces(output);
+		REQUIRE(!strcmp(input, output));
+	}
+
+	free(output);
+
+	TEST("Stream output") {
+		output = ason_asprint(test);
+		len = strlen(output);
+
+		REQUIRE(! pipe(fds));
+		REQUIRE(ason_write(fds[1], test) == (ssize_t)len);
+		REQUIRE(read(fds[0], streamed, sizeof(streamed)) == (ssize_t)len);
+		REQUIRE(! memcmp(output, streamed, len));
+		close(fds[0]);
+		close(fds[1]);
+
+		file = tmpfile();
+		REQUIRE(file);
+		REQUIRE(ason_fprint(file, test) == (ssize_t)len);
+		rewind(file);
+		REQUIRE(fread(streamed, 1, sizeof(streamed), file) == len);
+		REQUIRE(! memcmp(output, streamed, len));
+		fclose(file);
+
+		REQUIRE(ason_write(-1, test) < 0);
+	}
+
+	free(output);
+	ason_destroy(test);
+
 	return 0;
 }
@@ -0,0 +1,120 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/scan.h"
+#include "harness.h"
+
+TESTS(3);
+
+/**
+ * Check that scan_next_structural() stops at exactly the brackets, braces,
+ * parentheses, commas and question marks outside of strings, found by walking
+ * the text a byte at a time. A quote after an odd run of backslashes does not
+ * start or end a string.
+ **/
+static int
+structural_matches(const char *text, size_t length)
+{
+	struct scan_index idx;
+	const char *pos = text;
+	size_t backslashes = 0;
+	int in_string = 0;
+	int ret = 1;
+	size_t i;
+
+	scan_index_build(&idx, text, length);
+
+	for (i = 0; i < length && ret; i++) {
+		if (text[i] == '\\') {
+			backslashes++;
+			continue;
+		}
+
+		if (text[i] == '"' && ! (backslashes % 2))
+			in_string = ! in_string;
+
+		backslashes = 0;
+
+		if (in_string || ! text[i] || ! strchr("[]{}(),?", text[i]))
+			continue;
+
+		pos = scan_next_structural(&idx, pos);
+		ret = pos == text + i;
+		pos++;
+	}
+
+	if (ret)
+		ret = scan_next_structural(&idx, pos) == text + length;
+
+	scan_index_free(&idx);
+	return ret;
+}
+
+/**
+ * Exercise the structural index.
+ **/
+TEST_MAIN("Structural index")
+{
+	static const char pieces[] = "[]{}(),? \"\\ax";
+	char text[1024];
+	size_t length;
+	size_t i;
+	int run;
+
+	TEST("Structural characters") {
+		REQUIRE(structural_matches("", 0));
+		REQUIRE(structural_matches("[1, {\"a\": (2 | ?i)}]", 20));
+		REQUIRE(structural_matches("[\"],\", \"\\\",[\", 3]", 17));
+		REQUIRE(structural_matches("[\"\\\\\", \"\\\\\\\"]\"]", 15));
+	}
+
+	TEST("Strings across blocks") {
+		memset(text, 'x', sizeof(text));
+		text[0] = '[';
+		text[60] = '"';
+		text[100] = ',';
+		text[127] = '\\';
+		text[128] = '"';
+		text[129] = ']';
+		text[200] = '"';
+		text[201] = ',';
+		text[300] = ']';
+		REQUIRE(structural_matches(text, 301));
+	}
+
+	TEST("Random text") {
+		srand(1);
+
+		for (run = 0; run < 200; run++) {
+			length = rand() % sizeof(text);
+
+			for (i = 0; i < length; i++)
+				text[i] = pieces[rand() % (sizeof(pieces) - 1)];
+
+			REQUIRE(structural_matches(text, length));
+		}
+	}
+
+	return 0;
+}
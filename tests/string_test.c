@@ -0,0 +1,139 @@
+/**
+ * Copyright © 2015 Casey Dahlin <casey.dahlin@gmail.com>
+ *
+ * This file is part of libason.
+ *
+ * libason is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libason is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libason. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/stringfunc.h"
+#include "harness.h"
+
+TESTS(8);
+
+/**
+ * Escape a string and compare it to what we expect. Free the result.
+ **/
+static int
+escapes_to(const char *in, const char *expect)
+{
+	char *out = string_escape(in);
+	int ret = ! strcmp(out, expect);
+
+	free(out);
+	return ret;
+}
+
+/**
+ * Exercise string conversion and escaping.
+ **/
+TEST_MAIN("Strings")
+{
+	size_t length;
+	char *out;
+	char plain[200];
+	char long_in[200];
+	char long_out[300];
+
+	TEST("Escape plain text") {
+		REQUIRE(escapes_to("", ""));
+		REQUIRE(escapes_to("Hello, world!", "Hello, world!"));
+	}
+
+	TEST("Escape special characters") {
+		REQUIRE(escapes_to("\"\\/\b\f\n\r\t\v",
+				   "\\\"\\\\\\/\\b\\f\\n\\r\\t\\v"));
+		REQUIRE(escapes_to("a\x01z\x7f", "a\\u0001z\\u007f"));
+	}
+
+	TEST("Escape non-ASCII characters") {
+		REQUIRE(escapes_to("\xc2\xa9 caf\xc3\xa9", "\\u00a9 caf\\u00e9"));
+		REQUIRE(escapes_to("\xe2\x82\xac", "\\u20ac"));
+		REQUIRE(escapes_to("\xf0\x9f\x98\x80", "\\ud83d\\ude00"));
+	}
+
+	TEST("Escape malformed UTF-8") {
+		REQUIRE(escapes_to("a\xff" "b", "a\\ufffdb"));
+		REQUIRE(escapes_to("\xc0\xaf", "\\ufffd\\ufffd"));
+		REQUIRE(escapes_to("\xed\xa0\x80", "\\ufffd\\ufffd\\ufffd"));
+		REQUIRE(escapes_to("\xe2\x82", "\\ufffd\\ufffd"));
+	}
+
+	TEST("Escape across blocks") {
+		memset(plain, 'x', sizeof(plain) - 1);
+		plain[sizeof(plain) - 1] = '\0';
+		memcpy(long_in, plain, sizeof(plain));
+		REQUIRE(escapes_to(long_in, plain));
+
+		long_in[31] = '"';
+		long_in[64] = '\n';
+		long_in[150] = '\xc3';
+		long_in[151] = '\xa9';
+
+		sprintf(long_out, "%.31s\\\"%.32s\\n%.85s\\u00e9%.47s",
+			plain, plain, plain, plain);
+		REQUIRE(escapes_to(long_in, long_out));
+	}
+
+	TEST("Unescape") {
+		strcpy(plain, "a\\u0041\\n\\ud83d\\ude00");
+		out = string_unescape(plain, strlen(plain));
+		REQUIRE(out && ! strcmp(out, "aA\n\xf0\x9f\x98\x80"));
+		free(out);
+
+		REQUIRE(! string_unescape("a\\u0000b", 8));
+		REQUIRE(! string_unescape("\\u000", 5));
+	}
+
+	TEST("Convert UTF-8 input") {
+		out = string_to_utf8("caf\xc3\xa9");
+		REQUIRE(! strcmp(out, "caf\xc3\xa9"));
+		free(out);
+
+		length = 3;
+		out = string_to_utf8_n("abcdef", &length);
+		REQUIRE(length == 3);
+		REQUIRE(! strcmp(out, "abc"));
+		free(out);
+	}
+
+	TEST("Convert Latin-1 input") {
+		input_locale = "ISO-8859-1";
+
+		out = string_to_utf8("caf\xe9");
+		REQUIRE(! strcmp(out, "caf\xc3\xa9"));
+		free(out);
+
+		length = 2;
+		out = string_to_utf8_n("\xe9t\xe9", &length);
+		REQUIRE(length == 3);
+		REQUIRE(! strcmp(out, "\xc3\xa9t"));
+		free(out);
+
+		memset(plain, '\xe9', sizeof(plain) - 1);
+		plain[sizeof(plain) - 1] = '\0';
+		out = string_to_utf8(plain);
+		REQUIRE(strlen(out) == 2 * (sizeof(plain) - 1));
+		REQUIRE(! memcmp(out + 2 * (sizeof(plain) - 2), "\xc3\xa9", 3));
+		free(out);
+
+		input_locale = "UTF-8";
+	}
+
+	return 0;
+}
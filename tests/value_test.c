@@ -19,7 +19,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include <ason/ason.h>
 #include <ason/read.h>
@@ -27,13 +29,89 @@
 
 #include "harness.h"
 
-TESTS(34);
+/**
+ * Copy, search and destroy a shared value many times. Returns non-NULL if a
+ * search gave the wrong answer.
+ **/
+static void *
+share_value(void *arg)
+{
+	ason_t *shared = arg;
+	ason_t *key = ason_read("\"key500\"");
+	ason_t *copy;
+	void *ret = NULL;
+	size_t i;
+
+	for (i = 0; i < 1000; i++) {
+		copy = ason_copy(shared);
+
+		if (! ason_check_represented_in(key, copy))
+			ret = arg;
+
+		ason_destroy(copy);
+	}
+
+	ason_destroy(key);
+	return ret;
+}
+
+/**
+ * Read two values and check whether they are equal.
+ **/
+static int
+read_equal(const char *a, const char *b)
+{
+	ason_t *va = ason_read(a);
+	ason_t *vb = ason_read(b);
+	int ret = va && vb && ason_check_equal(va, vb);
+
+	ason_destroy(va);
+	ason_destroy(vb);
+	return ret;
+}
+
+/**
+ * Read two values and check whether the first is represented in the second.
+ **/
+static int
+read_represented_in(const char *a, const char *b)
+{
+	ason_t *va = ason_read(a);
+	ason_t *vb = ason_read(b);
+	int ret = va && vb && ason_check_represented_in(va, vb);
+
+	ason_destroy(va);
+	ason_destroy(vb);
+	return ret;
+}
+
+TESTS(38);
+
+/**
+ * Build a union of `count` distinct strings, some of which are prefixes of
+ * others.
+ **/
+static char *
+string_union(size_t count)
+{
+	char *ret = malloc(count * 16);
+	size_t pos = 0;
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		pos += sprintf(ret + pos, "%s\"key%zu\"", i ? " | " : "", i);
+
+	return ret;
+}
 
 /**
  * Full exercise of value reduction.
  **/
 TEST_MAIN("Value Reduction")
 {
+	char *union_text = NULL;
+	char input[20000];
+
 	TEST_ASON_EXPR("Object redistribution",
 		       "{\"foo\": 6 | 7 | 8, \"bar\": 9}  = "
 		       "{\"foo\": 6, \"bar\": 9}  | "
@@ -223,6 +301,73 @@ TEST_MAIN("Value Reduction")
 		       "[6,7,8] | [6,5,8] | [6,7,9] = "
 		       "[6,7,8] | [6,7,9] | [6,5,8]");
 
+	TEST("String sets") {
+		REQUIRE(read_equal("\"b\" | \"a\" | \"c\" | \"a\"",
+				   "\"a\" | \"b\" | \"c\""));
+		REQUIRE(! read_equal("\"a\" | \"b\"", "\"a\" | \"bb\""));
+		REQUIRE(read_equal("(\"a\" | \"b\" | \"c\") & (\"b\" | \"d\")",
+				   "\"b\""));
+		REQUIRE(read_equal("(\"a\" | \"b\") & \"c\"", "_"));
+		REQUIRE(read_represented_in("\"b\"", "\"a\" | \"b\" | \"c\""));
+		REQUIRE(! read_represented_in("\"d\"",
+					      "\"a\" | \"b\" | \"c\""));
+	}
+
+	TEST("String set complements") {
+		REQUIRE(read_equal("!\"a\" & (\"a\" | \"b\")", "\"b\""));
+		REQUIRE(read_equal("!(\"a\" | \"b\") | \"a\"", "!\"b\""));
+		REQUIRE(read_equal("!(\"a\" | \"b\") | !(\"b\" | \"c\")",
+				   "!\"b\""));
+		REQUIRE(read_equal("!(\"a\" | \"b\") & !(\"b\" | \"c\")",
+				   "!(\"a\" | \"b\" | \"c\")"));
+		REQUIRE(read_equal("!\"a\" | \"a\"", "U"));
+		REQUIRE(read_represented_in("\"d\"", "!(\"a\" | \"b\")"));
+		REQUIRE(! read_represented_in("\"a\"", "!(\"a\" | \"b\")"));
+	}
+
+	TEST("Large string sets") {
+		union_text = string_union(1000);
+
+		REQUIRE(read_represented_in("\"key0\"", union_text));
+		REQUIRE(read_represented_in("\"key1\"", union_text));
+		REQUIRE(read_represented_in("\"key10\"", union_text));
+		REQUIRE(read_represented_in("\"key999\"", union_text));
+		REQUIRE(! read_represented_in("\"key\"", union_text));
+		REQUIRE(! read_represented_in("\"key1000\"", union_text));
+		REQUIRE(! read_represented_in("\"key01\"", union_text));
+		REQUIRE(! read_represented_in("\"kez1\"", union_text));
+		REQUIRE(! read_represented_in("\"\"", union_text));
+		REQUIRE(read_represented_in("\"key5\" | \"key50\"", union_text));
+		REQUIRE(! read_represented_in("\"key5\" | \"ke\"", union_text));
+
+		sprintf(input, "!(%s)", union_text);
+		REQUIRE(read_represented_in("\"key1000\"", input));
+		REQUIRE(! read_represented_in("\"key5\" | \"key1000\"",
+					      input));
+	}
+
+	TEST("Large string sets shared between threads") {
+		pthread_t threads[4];
+		void *result;
+		ason_t *shared = ason_read(union_text);
+		size_t i;
+
+		REQUIRE(shared);
+
+		for (i = 0; i < 4; i++)
+			REQUIRE(! pthread_create(&threads[i], NULL,
+						 share_value, shared));
+
+		for (i = 0; i < 4; i++) {
+			REQUIRE(! pthread_join(threads[i], &result));
+			REQUIRE(! result);
+		}
+
+		ason_destroy(shared);
+	}
+
+	free(union_text);
+
 	TEST("Destructor safety") {
 		ason_destroy(NULL);
 	}